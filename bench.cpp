@@ -0,0 +1,1153 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "bench.h"
+#include "board.h"
+#include "common.h"
+#include "eval.h"
+#include "evalhash.h"
+#include "hash.h"
+#include "output.h"
+#include "perfcounters.h"
+#include "search.h"
+#include "timeman.h"
+#include "uci.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+// Declared in search.cpp
+extern std::atomic<bool> isStop;
+extern std::atomic<bool> stopSignal;
+
+const std::vector<string> BENCH_POSITIONS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
+    "r2q4/pp1k1pp1/2p1r1np/5p2/2N5/1P5Q/5PPP/3RR1K1 b - -",
+    "5k2/1qr2pp1/2Np1n1r/QB2p3/2R4p/3PPRPb/PP2P2P/6K1 w - -",
+    "r2r2k1/2p2pp1/p1n4p/1qbnp3/2Q5/1PPP1RPP/3NN2K/R1B5 b - -",
+    "8/3k4/p6Q/pq6/3p4/1P6/P3p1P1/6K1 w - -",
+    "8/8/k7/2B5/P1K5/8/8/1r6 w - -",
+    "8/8/8/p1k4p/P2R3P/2P5/1K6/5q2 w - -",
+    "rnbq1k1r/ppp1ppb1/5np1/1B1pN2p/P2P1P2/2N1P3/1PP3PP/R1BQK2R w KQ -",
+    "4r3/6pp/2p1p1k1/4Q2n/1r2Pp2/8/6PP/2R3K1 w - -",
+    "8/3k2p1/p2P4/P5p1/8/1P1R1P2/5r2/3K4 w - -",
+    "r5k1/1bqnbp1p/r3p1p1/pp1pP3/2pP1P2/P1P2N1P/1P2NBP1/R2Q1RK1 b - -",
+    "r1bqk2r/1ppnbppp/p1np4/4p1P1/4PP2/3P1N1P/PPP5/RNBQKBR1 b Qkq -",
+    "5nk1/6pp/8/pNpp4/P7/1P1Pp3/6PP/6K1 w - -",
+    "2r2rk1/1p2npp1/1q1b1nbp/p2p4/P2N3P/BPN1P3/4BPP1/2RQ1RK1 w - -",
+    "8/2b3p1/4knNp/2p4P/1pPp1P2/1P1P1BPK/8/8 w - -"
+};
+
+BenchOptions::BenchOptions() {
+    searchMode = DEPTH;
+    limit = DEFAULT_BENCH_DEPTH;
+    format = BENCH_TEXT;
+    repetitions = DEFAULT_MICROBENCH_REPETITIONS;
+    warmup = DEFAULT_MICROBENCH_WARMUP;
+}
+
+// When an iteration of a bench search was completed, counted from the start
+// of the search
+struct BenchIteration {
+    int depth;
+    uint64_t micros;
+    uint64_t nodes;
+};
+
+// The result of searching one position
+struct BenchResult {
+    string fen;
+    Move bestMove;
+    // The last completed iteration
+    SearchInfo info;
+    uint64_t time;
+    SearchStatistics stats;
+    std::vector<SearchStatistics> threadStats;
+    // The iteration each thread was searching when the search ended
+    std::vector<int> threadDepths;
+    ChessTime startTime;
+    std::vector<BenchIteration> iterations;
+    uint64_t counters[NUM_PERF_COUNTERS];
+};
+
+// The results of running the suite with one thread count
+struct BenchRun {
+    int threads;
+    std::vector<BenchResult> results;
+    uint64_t nodes;
+    uint64_t time;
+    uint64_t counters[NUM_PERF_COUNTERS];
+    // Search statistics summed over the positions
+    SearchStatistics stats;
+};
+
+void collectBenchInfo(const SearchInfo &info, void *data) {
+    BenchResult *result = static_cast<BenchResult *>(data);
+    if (info.bound != BOUND_NONE)
+        result->info = info;
+    if (info.bound == BOUND_EXACT && info.multiPV == 1) {
+        BenchIteration iteration;
+        iteration.depth = info.depth;
+        iteration.micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            ChessClock::now() - result->startTime).count();
+        iteration.nodes = info.nodes;
+        result->iterations.push_back(iteration);
+    }
+}
+
+void collectBenchMove(Move bestMove, Move ponder, void *data) {
+    static_cast<BenchResult *>(data)->bestMove = bestMove;
+}
+
+// Returns false if the file could not be opened
+bool readBenchPositions(const string &path, std::vector<string> &fens) {
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+    string line;
+    while (std::getline(in, line)) {
+        string fen = epdToFEN(line);
+        if (fen.empty())
+            continue;
+        // Skip positions the search cannot handle, such as a missing king
+        Board b = fenToBoard(fen);
+        if (count(b.getPieces(WHITE, KINGS)) != 1 || count(b.getPieces(BLACK, KINGS)) != 1) {
+            cerr << "Skipping invalid position: " << fen << endl;
+            continue;
+        }
+        fens.push_back(fen);
+    }
+    return true;
+}
+
+void benchPosition(const string &fen, TimeManagement *timeParams, PerfCounters &counters,
+        BenchResult &result) {
+    MoveList movesToSearch;
+    Board board = fenToBoard(fen);
+    clearTables();
+
+    result.fen = fen;
+    result.bestMove = NULL_MOVE;
+    result.info.depth = 0;
+    result.info.selDepth = 0;
+    result.info.hashfull = 0;
+    result.iterations.clear();
+    setSearchCallbacks(collectBenchInfo, collectBenchMove, &result);
+
+    result.startTime = ChessClock::now();
+    isStop = false;
+    stopSignal = false;
+    counters.start();
+    getBestMove(&board, timeParams, &movesToSearch);
+    counters.stop();
+    isStop = true;
+    stopSignal = true;
+    result.time = getTimeElapsed(result.startTime);
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++)
+        result.counters[i] = counters.get(i);
+
+    setSearchCallbacks(nullptr, nullptr, nullptr);
+    result.stats = getSearchStatistics();
+    result.threadStats.clear();
+    result.threadDepths.clear();
+    for (int i = 0; i < getNumThreads(); i++) {
+        result.threadStats.push_back(getThreadStatistics(i));
+        result.threadDepths.push_back(getThreadSearchDepth(i));
+    }
+}
+
+uint64_t getNPS(uint64_t nodes, uint64_t time) {
+    return 1000 * nodes / std::max((uint64_t) 1, time);
+}
+
+string limitName(int searchMode) {
+    return (searchMode == NODES) ? "nodes" : (searchMode == MOVETIME) ? "movetime" : "depth";
+}
+
+// Writes the available hardware counters divided by the number of operations
+void writeCountersJSON(std::ostream &out, PerfCounters &counters, const uint64_t *values,
+        uint64_t ops) {
+    if (!counters.anyAvailable()) {
+        out << "null";
+        return;
+    }
+    out << "{";
+    bool first = true;
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (!counters.isAvailable(i))
+            continue;
+        out << (first ? "" : ", ") << "\"" << PERF_COUNTER_NAMES[i] << "\": "
+            << (double) values[i] / std::max((uint64_t) 1, ops);
+        first = false;
+    }
+    out << "}";
+}
+
+// Writes one column for each counter, left empty if it is not available
+void writeCountersCSV(std::ostream &out, PerfCounters &counters, const uint64_t *values,
+        uint64_t ops) {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        out << ",";
+        if (counters.isAvailable(i) && values != nullptr)
+            out << (double) values[i] / std::max((uint64_t) 1, ops);
+    }
+}
+
+void writeCountersText(PerfCounters &counters, const uint64_t *values, uint64_t ops,
+        const char *unit) {
+    if (!counters.anyAvailable()) {
+        cerr << "Hardware counters: unavailable" << endl;
+        return;
+    }
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (counters.isAvailable(i)) {
+            cerr << PERF_COUNTER_NAMES[i] << "/" << unit << ": "
+                 << (double) values[i] / std::max((uint64_t) 1, ops) << endl;
+        }
+    }
+}
+
+void writeTechniqueJSON(std::ostream &out, const char *name, uint64_t tries, uint64_t successes) {
+    out << "\"" << name << "\": {\"tries\": " << tries << ", \"successes\": " << successes << "}";
+}
+
+// Writes how often each pruning, reduction, and extension technique applied
+void writePruningJSON(std::ostream &out, const SearchStatistics &stats) {
+    out << "{";
+    writeTechniqueJSON(out, "reversefutility", stats.reverseFutilityTries, stats.reverseFutilityPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "razoring", stats.razorTries, stats.razorPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "nullmove", stats.nullMoveTries, stats.nullMovePrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "nullverify", stats.nullVerifyTries, stats.nullVerifyPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "futility", stats.futilityTries, stats.futilityPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "lmp", stats.lmpTries, stats.lmpPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "history", stats.historyPruneTries, stats.historyPrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "see", stats.seePruneTries, stats.seePrunes);
+    out << ", ";
+    writeTechniqueJSON(out, "checkext", stats.checkExtensionTries, stats.checkExtensions);
+    out << ", ";
+    writeTechniqueJSON(out, "singularext", stats.singularTries, stats.singularExtensions);
+    out << ", \"iid\": " << stats.iidSearches
+        << ", \"iir\": " << stats.iirReductions;
+    // Reductions of LMR_STAT_REDUCTIONS or more plies share the last entry
+    out << ", \"lmr\": [";
+    for (int i = 0; i < LMR_STAT_REDUCTIONS; i++) {
+        out << (i ? ", " : "") << "{\"reduction\": " << i + 1
+            << ", \"reduced\": " << stats.lmrReductions[i]
+            << ", \"researched\": " << stats.lmrResearches[i] << "}";
+    }
+    out << "]}";
+}
+
+// The eval cache mode the suite ran with, so that runs with and without
+// EvalCachePerThread can be compared
+const char *evalCacheMode() {
+    return getEvalCachePerThread() ? "perthread" : "shared";
+}
+
+string escapeJSON(const string &s) {
+    string escaped;
+    for (unsigned int i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\')
+            escaped += '\\';
+        escaped += s[i];
+    }
+    return escaped;
+}
+
+void writeJSON(std::ostream &out, const BenchOptions &options, const std::vector<BenchRun> &runs,
+        PerfCounters &counters, bool hasSignature, uint64_t signature) {
+    out << "{\n";
+    out << "  \"engine\": \"" << ENGINE_NAME << " " << ENGINE_VERSION << "\",\n";
+    out << "  \"positions\": \"" << (options.positionFile.empty() ? "builtin"
+                                      : escapeJSON(options.positionFile)) << "\",\n";
+    out << "  \"limit\": {\"type\": \"" << limitName(options.searchMode)
+        << "\", \"value\": " << options.limit << "},\n";
+    out << "  \"hash\": " << getHashSize() << ",\n";
+    out << "  \"evalcachemode\": \"" << evalCacheMode() << "\",\n";
+    out << "  \"runs\": [\n";
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        const BenchRun &run = runs[r];
+        out << "    {\n";
+        out << "      \"threads\": " << run.threads << ",\n";
+        out << "      \"results\": [\n";
+        for (unsigned int i = 0; i < run.results.size(); i++) {
+            const BenchResult &result = run.results[i];
+            out << "        {\"fen\": \"" << escapeJSON(result.fen) << "\""
+                << ", \"bestmove\": \"" << moveToString(result.bestMove) << "\""
+                << ", \"depth\": " << result.info.depth
+                << ", \"seldepth\": " << result.info.selDepth
+                << ", \"nodes\": " << result.stats.nodes
+                << ", \"time\": " << result.time
+                << ", \"nps\": " << getNPS(result.stats.nodes, result.time)
+                << ", \"hashprobes\": " << result.stats.hashProbes
+                << ", \"hashhits\": " << result.stats.hashHits
+                << ", \"hashfull\": " << result.info.hashfull
+                << ", \"evalcacheprobes\": " << result.stats.evalCacheProbes
+                << ", \"evalcachehits\": " << result.stats.evalCacheHits
+                << ", \"pruning\": ";
+            writePruningJSON(out, result.stats);
+            out << ", \"counterspernode\": ";
+            writeCountersJSON(out, counters, result.counters, result.stats.nodes);
+            out << "}" << (i + 1 < run.results.size() ? ",\n" : "\n");
+        }
+        out << "      ],\n";
+        out << "      \"nodes\": " << run.nodes << ",\n";
+        out << "      \"time\": " << run.time << ",\n";
+        out << "      \"nps\": " << getNPS(run.nodes, run.time) << ",\n";
+        out << "      \"evalcacheprobes\": " << run.stats.evalCacheProbes << ",\n";
+        out << "      \"evalcachehits\": " << run.stats.evalCacheHits << ",\n";
+        out << "      \"pruning\": ";
+        writePruningJSON(out, run.stats);
+        out << ",\n";
+        out << "      \"counterspernode\": ";
+        writeCountersJSON(out, counters, run.counters, run.nodes);
+        out << "\n";
+        out << "    }" << (r + 1 < runs.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+    out << "  \"signature\": ";
+    if (hasSignature)
+        out << signature << "\n";
+    else
+        out << "null\n";
+    out << "}\n";
+}
+
+// Each run ends with a total row. The signature, if any, is the last row.
+void writeCSV(std::ostream &out, const std::vector<BenchRun> &runs, PerfCounters &counters,
+        bool hasSignature, uint64_t signature) {
+    out << "threads,position,fen,bestmove,depth,seldepth,nodes,time,nps,"
+        << "hashprobes,hashhits,hashfull,evalcachemode,evalcacheprobes,evalcachehits";
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++)
+        out << "," << PERF_COUNTER_NAMES[i] << "pernode";
+    out << "\n";
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        const BenchRun &run = runs[r];
+        for (unsigned int i = 0; i < run.results.size(); i++) {
+            const BenchResult &result = run.results[i];
+            out << run.threads << "," << i + 1 << ",\"" << result.fen << "\","
+                << moveToString(result.bestMove) << ","
+                << result.info.depth << "," << result.info.selDepth << ","
+                << result.stats.nodes << "," << result.time << ","
+                << getNPS(result.stats.nodes, result.time) << ","
+                << result.stats.hashProbes << "," << result.stats.hashHits << ","
+                << result.info.hashfull << "," << evalCacheMode() << ","
+                << result.stats.evalCacheProbes << "," << result.stats.evalCacheHits;
+            writeCountersCSV(out, counters, result.counters, result.stats.nodes);
+            out << "\n";
+        }
+        out << run.threads << ",total,,,,," << run.nodes << "," << run.time << ","
+            << getNPS(run.nodes, run.time) << ",,,," << evalCacheMode() << ","
+            << run.stats.evalCacheProbes << "," << run.stats.evalCacheHits;
+        writeCountersCSV(out, counters, run.counters, run.nodes);
+        out << "\n";
+    }
+    if (hasSignature) {
+        out << "1,signature,,,,," << signature << ",,,,,,,,";
+        writeCountersCSV(out, counters, nullptr, 0);
+        out << "\n";
+    }
+}
+
+// Searches every position once for each thread count
+void runSuite(const BenchOptions &options, const std::vector<string> &fens,
+        PerfCounters &counters, std::vector<BenchRun> &runs) {
+    TimeManagement timeParams;
+    timeParams.searchMode = options.searchMode;
+    timeParams.allotment = options.limit;
+    timeParams.maxAllotment = options.limit;
+
+    int prevThreads = getNumThreads();
+    for (unsigned int t = 0; t < options.threads.size(); t++) {
+        setNumThreads(options.threads[t]);
+        BenchRun run;
+        run.threads = options.threads[t];
+        run.nodes = 0;
+        run.time = 0;
+        for (int j = 0; j < NUM_PERF_COUNTERS; j++)
+            run.counters[j] = 0;
+        run.results.resize(fens.size());
+        for (unsigned int i = 0; i < fens.size(); i++) {
+            benchPosition(fens[i], &timeParams, counters, run.results[i]);
+            run.nodes += run.results[i].stats.nodes;
+            run.time += run.results[i].time;
+            run.stats.add(run.results[i].stats);
+            for (int j = 0; j < NUM_PERF_COUNTERS; j++)
+                run.counters[j] += run.results[i].counters[j];
+        }
+        runs.push_back(run);
+    }
+    setNumThreads(prevThreads);
+    clearTables();
+}
+
+// Reads the positions and opens the output file. Returns false on failure.
+bool openBench(const BenchOptions &options, std::vector<string> &fens, std::ofstream &file) {
+    if (options.positionFile.empty())
+        fens = BENCH_POSITIONS;
+    else if (!readBenchPositions(options.positionFile, fens)) {
+        writeLine("info string Could not open " + options.positionFile);
+        return false;
+    }
+
+    if (!options.outputFile.empty()) {
+        file.open(options.outputFile);
+        if (!file.is_open()) {
+            writeLine("info string Could not open " + options.outputFile);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes a JSON or CSV report to the output file if there is one, or else
+// line by line to stdout
+void writeReport(std::ofstream &file, const string &report) {
+    if (file.is_open())
+        file << report;
+    else {
+        std::istringstream lines(report);
+        string line;
+        while (std::getline(lines, line))
+            writeLine(line);
+    }
+}
+
+void runBench(const BenchOptions &options) {
+    std::vector<string> fens;
+    std::ofstream file;
+    if (!openBench(options, fens, file))
+        return;
+
+    PerfCounters counters;
+    std::vector<BenchRun> runs;
+    runSuite(options, fens, counters, runs);
+
+    // Only a single-threaded search without a time limit gives the same node
+    // count every time
+    bool hasSignature = false;
+    uint64_t signature = 0;
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        if (runs[r].threads == 1 && options.searchMode != MOVETIME) {
+            hasSignature = true;
+            signature = runs[r].nodes;
+        }
+    }
+
+    if (options.format != BENCH_TEXT) {
+        std::ostringstream report;
+        if (options.format == BENCH_JSON)
+            writeJSON(report, options, runs, counters, hasSignature, signature);
+        else
+            writeCSV(report, runs, counters, hasSignature, signature);
+
+        writeReport(file, report.str());
+    }
+    else {
+        for (unsigned int r = 0; r < runs.size(); r++) {
+            for (unsigned int i = 0; i < runs[r].results.size(); i++) {
+                const BenchResult &result = runs[r].results[i];
+                cerr << "Position " << i + 1 << "/" << runs[r].results.size()
+                     << " (" << runs[r].threads << " threads): "
+                     << moveToString(result.bestMove) << " depth " << result.info.depth
+                     << " nodes " << result.stats.nodes << " time " << result.time << endl;
+            }
+        }
+    }
+
+    flushOutput();
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        if (runs.size() > 1)
+            cerr << "Threads: " << runs[r].threads << endl;
+        cerr << "Nodes: " << runs[r].nodes << endl;
+        cerr << "Time: " << runs[r].time << endl;
+        cerr << "Nodes/second: " << getNPS(runs[r].nodes, runs[r].time) << endl;
+        cerr << "Eval cache hit rate (" << evalCacheMode() << "): "
+             << 100.0 * runs[r].stats.evalCacheHits / std::max((uint64_t) 1, runs[r].stats.evalCacheProbes)
+             << "% of " << runs[r].stats.evalCacheProbes << " probes" << endl;
+        writeCountersText(counters, runs[r].counters, runs[r].nodes, "node");
+    }
+    if (hasSignature)
+        cerr << "Signature: " << signature << endl;
+}
+
+//------------------------------------------------------------------------------
+//------------------------------SMP scaling bench-------------------------------
+//------------------------------------------------------------------------------
+
+// How one thread count compares with the first one, which is the baseline
+struct SMPScaling {
+    double npsSpeedup;
+    // Compares the time and nodes needed to complete the deepest iteration
+    // that every run completed, summed over the positions
+    double ttdSpeedup;
+    double nodeOverhead;
+    // Averaged over the positions, for each thread. Helper threads are
+    // stopped at the end of each iteration of the main thread, so the depth
+    // is the last iteration each thread was searching, not one it completed.
+    std::vector<double> threadDepths;
+    std::vector<double> threadHashHitRates;
+};
+
+// Returns the first iteration of at least the given depth, or nullptr
+const BenchIteration *findIteration(const BenchResult &result, int depth) {
+    for (unsigned int i = 0; i < result.iterations.size(); i++) {
+        if (result.iterations[i].depth >= depth)
+            return &result.iterations[i];
+    }
+    return nullptr;
+}
+
+void computeScaling(const std::vector<BenchRun> &runs, std::vector<SMPScaling> &scaling) {
+    const BenchRun &base = runs[0];
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        const BenchRun &run = runs[r];
+        SMPScaling s;
+        s.npsSpeedup = (double) getNPS(run.nodes, run.time)
+                     / std::max((uint64_t) 1, getNPS(base.nodes, base.time));
+
+        uint64_t baseMicros = 0, runMicros = 0, baseNodes = 0, runNodes = 0;
+        for (unsigned int i = 0; i < run.results.size(); i++) {
+            int depth = MAX_DEPTH;
+            for (unsigned int k = 0; k < runs.size(); k++) {
+                const std::vector<BenchIteration> &iterations = runs[k].results[i].iterations;
+                depth = std::min(depth, iterations.empty() ? 0 : iterations.back().depth);
+            }
+            const BenchIteration *baseIteration = findIteration(base.results[i], depth);
+            const BenchIteration *runIteration = findIteration(run.results[i], depth);
+            if (depth == 0 || baseIteration == nullptr || runIteration == nullptr)
+                continue;
+            baseMicros += baseIteration->micros;
+            runMicros += runIteration->micros;
+            baseNodes += baseIteration->nodes;
+            runNodes += runIteration->nodes;
+        }
+        s.ttdSpeedup = (double) baseMicros / std::max((uint64_t) 1, runMicros);
+        s.nodeOverhead = (double) runNodes / std::max((uint64_t) 1, baseNodes) - 1.0;
+
+        for (int t = 0; t < run.threads; t++) {
+            uint64_t depths = 0, probes = 0, hits = 0;
+            for (unsigned int i = 0; i < run.results.size(); i++) {
+                const SearchStatistics &stats = run.results[i].threadStats[t];
+                depths += run.results[i].threadDepths[t];
+                probes += stats.hashProbes;
+                hits += stats.hashHits;
+            }
+            s.threadDepths.push_back((double) depths / std::max((size_t) 1, run.results.size()));
+            s.threadHashHitRates.push_back((double) hits / std::max((uint64_t) 1, probes));
+        }
+        scaling.push_back(s);
+    }
+}
+
+void writeSMPJSON(std::ostream &out, const BenchOptions &options,
+        const std::vector<BenchRun> &runs, const std::vector<SMPScaling> &scaling) {
+    out << "{\n";
+    out << "  \"engine\": \"" << ENGINE_NAME << " " << ENGINE_VERSION << "\",\n";
+    out << "  \"positions\": \"" << (options.positionFile.empty() ? "builtin"
+                                      : escapeJSON(options.positionFile)) << "\",\n";
+    out << "  \"limit\": {\"type\": \"" << limitName(options.searchMode)
+        << "\", \"value\": " << options.limit << "},\n";
+    out << "  \"hash\": " << getHashSize() << ",\n";
+    out << "  \"runs\": [\n";
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        const BenchRun &run = runs[r];
+        const SMPScaling &s = scaling[r];
+        out << "    {\"threads\": " << run.threads
+            << ", \"nodes\": " << run.nodes
+            << ", \"time\": " << run.time
+            << ", \"nps\": " << getNPS(run.nodes, run.time)
+            << ", \"npsspeedup\": " << s.npsSpeedup
+            << ", \"ttdspeedup\": " << s.ttdSpeedup
+            << ", \"nodeoverhead\": " << s.nodeOverhead << ",\n";
+        out << "     \"threadstats\": [";
+        for (int t = 0; t < run.threads; t++) {
+            out << (t ? ", " : "") << "{\"thread\": " << t
+                << ", \"depth\": " << s.threadDepths[t]
+                << ", \"hashhitrate\": " << s.threadHashHitRates[t] << "}";
+        }
+        out << "]}" << (r + 1 < runs.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+// One row for each thread of each run
+void writeSMPCSV(std::ostream &out, const std::vector<BenchRun> &runs,
+        const std::vector<SMPScaling> &scaling) {
+    out << "threads,nodes,time,nps,npsspeedup,ttdspeedup,nodeoverhead,thread,depth,hashhitrate\n";
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        const BenchRun &run = runs[r];
+        const SMPScaling &s = scaling[r];
+        for (int t = 0; t < run.threads; t++) {
+            out << run.threads << "," << run.nodes << "," << run.time << ","
+                << getNPS(run.nodes, run.time) << "," << s.npsSpeedup << ","
+                << s.ttdSpeedup << "," << s.nodeOverhead << "," << t << ","
+                << s.threadDepths[t] << "," << s.threadHashHitRates[t] << "\n";
+        }
+    }
+}
+
+void runSMPBench(const BenchOptions &options) {
+    std::vector<string> fens;
+    std::ofstream file;
+    if (!openBench(options, fens, file) || fens.empty() || options.threads.empty())
+        return;
+
+    PerfCounters counters;
+    std::vector<BenchRun> runs;
+    runSuite(options, fens, counters, runs);
+    std::vector<SMPScaling> scaling;
+    computeScaling(runs, scaling);
+
+    if (options.format != BENCH_TEXT) {
+        std::ostringstream report;
+        if (options.format == BENCH_JSON)
+            writeSMPJSON(report, options, runs, scaling);
+        else
+            writeSMPCSV(report, runs, scaling);
+        writeReport(file, report.str());
+        flushOutput();
+    }
+
+    cerr << std::fixed << std::setprecision(2);
+    cerr << "Threads          NPS  NPS speedup  TTD speedup  Node overhead" << endl;
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        cerr << std::setw(7) << runs[r].threads
+             << std::setw(13) << getNPS(runs[r].nodes, runs[r].time)
+             << std::setw(13) << scaling[r].npsSpeedup
+             << std::setw(13) << scaling[r].ttdSpeedup
+             << std::setw(14) << 100 * scaling[r].nodeOverhead << "%" << endl;
+    }
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        cerr << "Threads " << runs[r].threads << ": depth / hash hit rate per thread:";
+        for (int t = 0; t < runs[r].threads; t++) {
+            cerr << " " << scaling[r].threadDepths[t]
+                 << "/" << 100 * scaling[r].threadHashHitRates[t] << "%";
+        }
+        cerr << endl;
+    }
+    cerr.unsetf(std::ios::floatfield);
+    cerr << std::setprecision(6);
+}
+
+//------------------------------------------------------------------------------
+//--------------------------------Microbenchmarks-------------------------------
+//------------------------------------------------------------------------------
+
+// Depth of the searches the corpus is taken from
+const int MICROBENCH_CORPUS_DEPTH = 8;
+// Each timed run of a component does at least this many operations
+const uint64_t MICROBENCH_MIN_OPS = 1000000;
+// Table sizes for the hash benchmarks, in MB
+const uint64_t MICROBENCH_HASH_SIZE = 16;
+
+// The tables used by the hash benchmarks, and a sink for results so that the
+// work cannot be optimized away
+struct MicroContext {
+    Hash *transTable;
+    EvalHash *evalCache;
+    Eval eval;
+    uint64_t sink;
+};
+
+// Each component does one pass over the corpus and returns the number of
+// operations done
+uint64_t microMoveGen(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++) {
+        MoveList moves;
+        corpus[i].getAllPseudoLegalMoves(moves, corpus[i].getPlayerToMove());
+        context.sink += moves.size();
+    }
+    return corpus.size();
+}
+
+uint64_t microLegalMoveGen(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.sink += corpus[i].getAllLegalMoves(corpus[i].getPlayerToMove()).size();
+    return corpus.size();
+}
+
+uint64_t microDoMove(std::vector<Board> &corpus, MicroContext &context) {
+    uint64_t ops = 0;
+    for (unsigned int i = 0; i < corpus.size(); i++) {
+        int color = corpus[i].getPlayerToMove();
+        MoveList moves;
+        corpus[i].getAllPseudoLegalMoves(moves, color);
+        for (unsigned int j = 0; j < moves.size(); j++) {
+            Board copy = corpus[i].staticCopy();
+            context.sink += copy.doPseudoLegalMove(moves.get(j), color);
+            context.sink += copy.getZobristKey();
+        }
+        ops += moves.size();
+    }
+    return ops;
+}
+
+uint64_t microEvaluate(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.sink += context.eval.evaluate(corpus[i]);
+    return corpus.size();
+}
+
+uint64_t microSEE(std::vector<Board> &corpus, MicroContext &context) {
+    uint64_t ops = 0;
+    for (unsigned int i = 0; i < corpus.size(); i++) {
+        int color = corpus[i].getPlayerToMove();
+        MoveList captures;
+        corpus[i].getPseudoLegalCaptures(captures, color, false);
+        for (unsigned int j = 0; j < captures.size(); j++)
+            context.sink += corpus[i].getSEEForMove(color, captures.get(j));
+        ops += captures.size();
+    }
+    return ops;
+}
+
+uint64_t microHashAdd(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.transTable->add(corpus[i], i + 1, i % MAX_DEPTH, 0);
+    return corpus.size();
+}
+
+uint64_t microHashGet(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.sink += context.transTable->get(corpus[i]);
+    return corpus.size();
+}
+
+uint64_t microEvalHashAdd(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.evalCache->add(corpus[i], (int) (i % 1000));
+    return corpus.size();
+}
+
+uint64_t microEvalHashGet(std::vector<Board> &corpus, MicroContext &context) {
+    for (unsigned int i = 0; i < corpus.size(); i++)
+        context.sink += context.evalCache->get(corpus[i]);
+    return corpus.size();
+}
+
+struct MicroComponent {
+    const char *name;
+    uint64_t (*run)(std::vector<Board> &corpus, MicroContext &context);
+};
+
+const MicroComponent MICRO_COMPONENTS[] = {
+    {"movegen", microMoveGen},
+    {"legalmovegen", microLegalMoveGen},
+    {"domove", microDoMove},
+    {"evaluate", microEvaluate},
+    {"see", microSEE},
+    {"hashadd", microHashAdd},
+    {"hashget", microHashGet},
+    {"evalhashadd", microEvalHashAdd},
+    {"evalhashget", microEvalHashGet}
+};
+
+struct MicroResult {
+    string name;
+    uint64_t ops;
+    double medianNs;
+    double bestNs;
+    // Counted over all timed runs
+    uint64_t totalOps;
+    uint64_t counters[NUM_PERF_COUNTERS];
+};
+
+// Adds the positions along every PV reported by a search
+void collectCorpusInfo(const SearchInfo &info, void *data) {
+    if (info.bound != BOUND_EXACT)
+        return;
+    std::pair<Board, std::vector<Board> *> *corpusData =
+        static_cast<std::pair<Board, std::vector<Board> *> *>(data);
+    Board b = corpusData->first.staticCopy();
+    for (int i = 0; i < info.pvLength; i++) {
+        if (!b.doPseudoLegalMove(info.pv[i], b.getPlayerToMove()))
+            break;
+        corpusData->second->push_back(b);
+    }
+}
+
+void collectCorpusMove(Move bestMove, Move ponder, void *data) {}
+
+// Builds the corpus from single-threaded searches of the bench positions,
+// without duplicates
+void buildCorpus(const std::vector<string> &fens, std::vector<Board> &corpus) {
+    TimeManagement timeParams;
+    timeParams.searchMode = DEPTH;
+    timeParams.allotment = MICROBENCH_CORPUS_DEPTH;
+    int prevThreads = getNumThreads();
+    setNumThreads(1);
+
+    std::vector<Board> positions;
+    for (unsigned int i = 0; i < fens.size(); i++) {
+        MoveList movesToSearch;
+        std::pair<Board, std::vector<Board> *> corpusData(fenToBoard(fens[i]), &positions);
+        positions.push_back(corpusData.first);
+        clearTables();
+        setSearchCallbacks(collectCorpusInfo, collectCorpusMove, &corpusData);
+        isStop = false;
+        stopSignal = false;
+        getBestMove(&corpusData.first, &timeParams, &movesToSearch);
+        isStop = true;
+        stopSignal = true;
+        setSearchCallbacks(nullptr, nullptr, nullptr);
+    }
+    setNumThreads(prevThreads);
+    clearTables();
+
+    std::vector<uint64_t> keys;
+    for (unsigned int i = 0; i < positions.size(); i++) {
+        uint64_t key = positions[i].getZobristKey();
+        if (std::find(keys.begin(), keys.end(), key) != keys.end())
+            continue;
+        keys.push_back(key);
+        corpus.push_back(positions[i]);
+    }
+}
+
+// Runs one component over the corpus until at least MICROBENCH_MIN_OPS
+// operations are done, and returns the time per operation in ns
+double timeComponent(const MicroComponent &component, std::vector<Board> &corpus,
+        MicroContext &context, uint64_t &ops) {
+    ops = 0;
+    auto startTime = ChessClock::now();
+    while (ops < MICROBENCH_MIN_OPS) {
+        uint64_t passOps = component.run(corpus, context);
+        if (passOps == 0)
+            break;
+        ops += passOps;
+    }
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        ChessClock::now() - startTime).count();
+    return (double) ns / std::max((uint64_t) 1, ops);
+}
+
+void runMicroBench(const BenchOptions &options) {
+    std::vector<string> fens;
+    std::ofstream file;
+    if (!openBench(options, fens, file))
+        return;
+
+    std::vector<Board> corpus;
+    buildCorpus(fens, corpus);
+    if (corpus.empty())
+        return;
+
+    MicroContext context;
+    context.transTable = new Hash(MICROBENCH_HASH_SIZE);
+    context.evalCache = new EvalHash(MICROBENCH_HASH_SIZE);
+    context.sink = 0;
+
+    PerfCounters counters;
+    std::vector<MicroResult> results;
+    for (const MicroComponent &component : MICRO_COMPONENTS) {
+        MicroResult result;
+        uint64_t ops = 0;
+        for (int i = 0; i < options.warmup; i++)
+            timeComponent(component, corpus, context, ops);
+        std::vector<double> times;
+        result.totalOps = 0;
+        counters.start();
+        for (int i = 0; i < std::max(1, options.repetitions); i++) {
+            times.push_back(timeComponent(component, corpus, context, ops));
+            result.totalOps += ops;
+        }
+        counters.stop();
+        std::sort(times.begin(), times.end());
+
+        result.name = component.name;
+        result.ops = ops;
+        result.medianNs = times[times.size() / 2];
+        result.bestNs = times[0];
+        for (int i = 0; i < NUM_PERF_COUNTERS; i++)
+            result.counters[i] = counters.get(i);
+        results.push_back(result);
+    }
+    delete context.transTable;
+    delete context.evalCache;
+
+    std::ostringstream report;
+    if (options.format == BENCH_JSON) {
+        report << "{\n";
+        report << "  \"engine\": \"" << ENGINE_NAME << " " << ENGINE_VERSION << "\",\n";
+        report << "  \"positions\": " << corpus.size() << ",\n";
+        report << "  \"repetitions\": " << std::max(1, options.repetitions) << ",\n";
+        report << "  \"warmup\": " << options.warmup << ",\n";
+        report << "  \"components\": [\n";
+        for (unsigned int i = 0; i < results.size(); i++) {
+            report << "    {\"name\": \"" << results[i].name << "\""
+                   << ", \"ops\": " << results[i].ops
+                   << ", \"nsperop\": " << results[i].medianNs
+                   << ", \"bestnsperop\": " << results[i].bestNs
+                   << ", \"opspersec\": " << (uint64_t) (1e9 / results[i].medianNs)
+                   << ", \"countersperop\": ";
+            writeCountersJSON(report, counters, results[i].counters, results[i].totalOps);
+            report << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        report << "  ]\n";
+        report << "}\n";
+    }
+    else if (options.format == BENCH_CSV) {
+        report << "component,ops,nsperop,bestnsperop,opspersec";
+        for (int i = 0; i < NUM_PERF_COUNTERS; i++)
+            report << "," << PERF_COUNTER_NAMES[i] << "perop";
+        report << "\n";
+        for (unsigned int i = 0; i < results.size(); i++) {
+            report << results[i].name << "," << results[i].ops << "," << results[i].medianNs
+                   << "," << results[i].bestNs << "," << (uint64_t) (1e9 / results[i].medianNs);
+            writeCountersCSV(report, counters, results[i].counters, results[i].totalOps);
+            report << "\n";
+        }
+    }
+    if (options.format != BENCH_TEXT) {
+        writeReport(file, report.str());
+        flushOutput();
+    }
+
+    cerr << "Positions: " << corpus.size() << endl;
+    cerr << std::fixed << std::setprecision(2);
+    cerr << "Component         ns/op     best ns/op        ops/sec" << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        cerr << std::left << std::setw(12) << results[i].name << std::right
+             << std::setw(12) << results[i].medianNs
+             << std::setw(15) << results[i].bestNs
+             << std::setw(15) << (uint64_t) (1e9 / results[i].medianNs) << endl;
+    }
+    if (counters.anyAvailable()) {
+        cerr << "Hardware counters per op:" << endl;
+        cerr << std::setw(12) << "";
+        for (int j = 0; j < NUM_PERF_COUNTERS; j++) {
+            if (counters.isAvailable(j))
+                cerr << std::setw(14) << PERF_COUNTER_NAMES[j];
+        }
+        cerr << endl;
+        for (unsigned int i = 0; i < results.size(); i++) {
+            cerr << std::left << std::setw(12) << results[i].name << std::right;
+            for (int j = 0; j < NUM_PERF_COUNTERS; j++) {
+                if (counters.isAvailable(j))
+                    cerr << std::setw(14) << (double) results[i].counters[j]
+                                             / std::max((uint64_t) 1, results[i].totalOps);
+            }
+            cerr << endl;
+        }
+    }
+    else
+        cerr << "Hardware counters: unavailable" << endl;
+    cerr.unsetf(std::ios::floatfield);
+    cerr << std::setprecision(6);
+    // Printed so that the timed work has a visible result
+    cerr << "Checksum: " << context.sink << endl;
+}
+
+//------------------------------------------------------------------------------
+//-------------------------------------Perft------------------------------------
+//------------------------------------------------------------------------------
+
+/*
+ * Performs a PERFT (performance test). Useful for testing/debugging
+ * PERFT n counts the number of possible positions after n moves by either side,
+ * ex. PERFT 4 = # of positions after 2 moves from each side
+ *
+ * 7/8/15: PERFT 5, 1.46 s (i5-2450m)
+ * 7/11/15: PERFT 5, 1.22 s (i5-2450m)
+ * 7/13/15: PERFT 5, 1.08 s (i5-2450m)
+ * 7/14/15: PERFT 5, 0.86 s (i5-2450m)
+ * 7/17/15: PERFT 5, 0.32 s (i5-2450m)
+ * 8/7/15: PERFT 5, 0.25 s, PERFT 6, 6.17 s (i5-5200u)
+ * 8/8/15: PERFT 6, 5.90 s (i5-5200u)
+ * 8/11/15: PERFT 6, 5.20 s (i5-5200u)
+ */
+uint64_t perft(Board &b, int color, int depth, uint64_t &captures) {
+    if (depth == 0)
+        return 1;
+
+    uint64_t nodes = 0;
+
+    MoveList pl;
+    b.getAllPseudoLegalMoves(pl, color);
+    for (unsigned int i = 0; i < pl.size(); i++) {
+        Board copy = b.staticCopy();
+        if (!copy.doPseudoLegalMove(pl.get(i), color))
+            continue;
+
+        if (isCapture(pl.get(i)))
+            captures++;
+
+        nodes += perft(copy, color^1, depth-1, captures);
+    }
+
+    return nodes;
+}
+
+// A position with its known perft results, from depth 1 up
+struct PerftPosition {
+    const char *fen;
+    // The depth searched by default
+    int defaultDepth;
+    std::vector<uint64_t> nodes;
+};
+
+// Standard perft positions, and positions testing castling, en passant,
+// promotions, pins, and discovered checks
+const std::vector<PerftPosition> PERFT_POSITIONS = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5,
+        {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4,
+        {48, 2039, 97862, 4085603, 193690690}},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5,
+        {14, 191, 2812, 43238, 674624, 11030083}},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4,
+        {6, 264, 9467, 422333, 15833292}},
+    {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4,
+        {6, 264, 9467, 422333, 15833292}},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4,
+        {44, 1486, 62379, 2103487, 89941194}},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4,
+        {46, 2079, 89890, 3894594, 164075551}},
+    // Illegal en passant captures
+    {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, {18, 92, 1670, 10138, 185429, 1134888}},
+    {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, {13, 102, 1266, 10276, 135655, 1015133}},
+    // En passant capture giving check
+    {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, {15, 126, 1928, 13931, 206379, 1440467}},
+    // Castling giving check
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, {15, 66, 1198, 6399, 120330, 661072}},
+    {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, {16, 71, 1286, 7418, 141077, 803711}},
+    // Castling rights and castling through attacked squares
+    {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, {26, 1141, 27826, 1274206}},
+    {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, {44, 1494, 50509, 1720476}},
+    // Promotions out of check and giving check
+    {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, {11, 133, 1442, 19174, 266199, 3821001}},
+    {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, {9, 40, 472, 2661, 38983, 217342}},
+    {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, {6, 27, 273, 1329, 18135, 92683}},
+    // Discovered check
+    {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, {29, 165, 5160, 31961, 1004658}},
+    // Stalemate and checkmate
+    {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, {2, 6, 13, 63, 382, 2217}},
+    {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, {10, 25, 268, 926, 10857, 43261, 567584}},
+    {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, {37, 183, 6559, 23527}}
+};
+
+struct PerftResult {
+    string fen;
+    int depth;
+    uint64_t expected;
+    uint64_t nodes;
+    uint64_t time;
+};
+
+bool runPerftSuite(const BenchOptions &options) {
+    std::ofstream file;
+    if (!options.outputFile.empty()) {
+        file.open(options.outputFile);
+        if (!file.is_open()) {
+            writeLine("info string Could not open " + options.outputFile);
+            return false;
+        }
+    }
+
+    std::vector<PerftResult> results;
+    uint64_t totalNodes = 0, totalTime = 0;
+    int failures = 0;
+    for (unsigned int i = 0; i < PERFT_POSITIONS.size(); i++) {
+        const PerftPosition &position = PERFT_POSITIONS[i];
+        PerftResult result;
+        result.fen = position.fen;
+        result.depth = (options.limit > 0) ? std::min(options.limit, (int) position.nodes.size())
+                                           : position.defaultDepth;
+        result.expected = position.nodes[result.depth - 1];
+
+        Board b = fenToBoard(result.fen);
+        uint64_t captures = 0;
+        auto startTime = ChessClock::now();
+        result.nodes = perft(b, b.getPlayerToMove(), result.depth, captures);
+        result.time = getTimeElapsed(startTime);
+
+        totalNodes += result.nodes;
+        totalTime += result.time;
+        if (result.nodes != result.expected)
+            failures++;
+        results.push_back(result);
+    }
+
+    std::ostringstream report;
+    if (options.format == BENCH_JSON) {
+        report << "{\n";
+        report << "  \"results\": [\n";
+        for (unsigned int i = 0; i < results.size(); i++) {
+            report << "    {\"fen\": \"" << results[i].fen << "\""
+                   << ", \"depth\": " << results[i].depth
+                   << ", \"expected\": " << results[i].expected
+                   << ", \"nodes\": " << results[i].nodes
+                   << ", \"pass\": " << (results[i].nodes == results[i].expected ? "true" : "false")
+                   << ", \"time\": " << results[i].time
+                   << ", \"nps\": " << getNPS(results[i].nodes, results[i].time) << "}"
+                   << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        report << "  ],\n";
+        report << "  \"failures\": " << failures << ",\n";
+        report << "  \"nodes\": " << totalNodes << ",\n";
+        report << "  \"time\": " << totalTime << ",\n";
+        report << "  \"nps\": " << getNPS(totalNodes, totalTime) << "\n";
+        report << "}\n";
+    }
+    else if (options.format == BENCH_CSV) {
+        report << "fen,depth,expected,nodes,pass,time,nps\n";
+        for (unsigned int i = 0; i < results.size(); i++) {
+            report << "\"" << results[i].fen << "\"," << results[i].depth << ","
+                   << results[i].expected << "," << results[i].nodes << ","
+                   << (results[i].nodes == results[i].expected ? "pass" : "fail") << ","
+                   << results[i].time << "," << getNPS(results[i].nodes, results[i].time) << "\n";
+        }
+    }
+    if (options.format != BENCH_TEXT) {
+        writeReport(file, report.str());
+        flushOutput();
+    }
+    else {
+        for (unsigned int i = 0; i < results.size(); i++) {
+            cerr << (results[i].nodes == results[i].expected ? "pass " : "FAIL ")
+                 << results[i].fen << " depth " << results[i].depth
+                 << " nodes " << results[i].nodes;
+            if (results[i].nodes != results[i].expected)
+                cerr << " expected " << results[i].expected;
+            cerr << " nps " << getNPS(results[i].nodes, results[i].time) << endl;
+        }
+    }
+
+    cerr << "Passed: " << results.size() - failures << "/" << results.size() << endl;
+    cerr << "Nodes: " << totalNodes << endl;
+    cerr << "Time: " << totalTime << endl;
+    cerr << "Nodes/second: " << getNPS(totalNodes, totalTime) << endl;
+    return failures == 0;
+}
@@ -0,0 +1,90 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <string>
+#include <vector>
+#include "board.h"
+
+const int DEFAULT_BENCH_DEPTH = 11;
+const int DEFAULT_SMPBENCH_MOVETIME = 1000;
+const int DEFAULT_MICROBENCH_REPETITIONS = 5;
+const int DEFAULT_MICROBENCH_WARMUP = 1;
+
+// Report formats
+const int BENCH_TEXT = 0;
+const int BENCH_JSON = 1;
+const int BENCH_CSV = 2;
+
+struct BenchOptions {
+    // EPD or FEN file with the positions, or empty for the built-in ones
+    std::string positionFile;
+    // DEPTH, NODES, or MOVETIME, with the limit per position
+    int searchMode;
+    int limit;
+    // The suite is run once for each thread count
+    std::vector<int> threads;
+    int format;
+    // The report is written here, or to stdout if empty
+    std::string outputFile;
+    // Timed and untimed runs of each microbench component
+    int repetitions;
+    int warmup;
+
+    BenchOptions();
+};
+
+/*
+ * Searches each bench position from cleared tables, once for each thread
+ * count, and reports the nodes, time, depth, and hash and eval cache usage for
+ * every position. The totals always go to stderr. The single-threaded node
+ * count of a depth or node limited run is deterministic, and is printed as
+ * the signature of the build.
+ */
+void runBench(const BenchOptions &options);
+
+/*
+ * Runs the bench positions with each thread count under a time or node limit,
+ * and compares each run with the first one. The report has the NPS speedup,
+ * the time-to-depth speedup and node overhead for the deepest iteration that
+ * every run completed, and the average completed depth and hash hit rate of
+ * each thread.
+ */
+void runSMPBench(const BenchOptions &options);
+
+/*
+ * Times move generation, doMove, evaluation, SEE, and transposition table and
+ * eval cache probes in isolation, over the positions along the PVs of
+ * single-threaded searches of the bench positions. After the warmup runs,
+ * each component is run the given number of times, and the median and best
+ * ns/op are reported.
+ */
+void runMicroBench(const BenchOptions &options);
+
+uint64_t perft(Board &b, int color, int depth, uint64_t &captures);
+
+/*
+ * Runs perft on a set of positions with known results, at each position's
+ * default depth, or at the given depth capped at the deepest known result.
+ * Returns false if any count is wrong.
+ */
+bool runPerftSuite(const BenchOptions &options);
+
+#endif
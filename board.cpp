@@ -19,7 +19,9 @@
 #include <algorithm>
 #include <cstring>
 #include <random>
+#include <sstream>
 #include <string>
+#include <vector>
 #include "board.h"
 #include "bbinit.h"
 #include "eval.h"
@@ -35,6 +37,17 @@ const uint64_t BLACK_QSIDE_PASSTHROUGH_SQS = indexToBit(57) | indexToBit(58) | i
 uint64_t zobristTable[794];
 static uint64_t startPosZobristKey = 0;
 
+// Cuckoo tables of the Zobrist key differences of all reversible piece moves,
+// used to detect upcoming repetitions. Idea from Marcel van Kervinck and
+// Stockfish.
+static uint64_t cuckooKeys[CUCKOO_SIZE];
+static Move cuckooMoves[CUCKOO_SIZE];
+
+inline int cuckooH1(uint64_t key) { return (int) (key & (CUCKOO_SIZE - 1)); }
+inline int cuckooH2(uint64_t key) { return (int) ((key >> 16) & (CUCKOO_SIZE - 1)); }
+
+void initCuckooTables();
+
 void initZobristTable() {
     std::mt19937_64 rng (61280152908);
     for (int i = 0; i < 794; i++)
@@ -45,6 +58,52 @@ void initZobristTable() {
     b.initZobristKey(mailbox);
     startPosZobristKey = b.getZobristKey();
     delete[] mailbox;
+
+    initCuckooTables();
+}
+
+// Inserts every knight, bishop, rook, queen, and king move on an empty board
+// into the cuckoo tables.
+void initCuckooTables() {
+    for (int i = 0; i < CUCKOO_SIZE; i++) {
+        cuckooKeys[i] = 0;
+        cuckooMoves[i] = NULL_MOVE;
+    }
+
+    for (int color = WHITE; color <= BLACK; color++) {
+        for (int pieceID = KNIGHTS; pieceID <= KINGS; pieceID++) {
+            for (int sq1 = 0; sq1 < 64; sq1++) {
+                for (int sq2 = sq1 + 1; sq2 < 64; sq2++) {
+                    int fileDiff = abs((sq1 & 7) - (sq2 & 7));
+                    int rankDiff = abs((sq1 >> 3) - (sq2 >> 3));
+                    bool isDiagonal = (fileDiff == rankDiff);
+                    bool isStraight = (fileDiff == 0 || rankDiff == 0);
+                    bool canReach = (pieceID == KNIGHTS) ? (bool) (KNIGHTMOVES[sq1] & indexToBit(sq2))
+                                  : (pieceID == BISHOPS) ? isDiagonal
+                                  : (pieceID == ROOKS)   ? isStraight
+                                  : (pieceID == QUEENS)  ? (isDiagonal || isStraight)
+                                                         : (bool) (KINGMOVES[sq1] & indexToBit(sq2));
+                    if (!canReach)
+                        continue;
+
+                    Move m = encodeMove(sq1, sq2);
+                    uint64_t key = zobristTable[384*color + 64*pieceID + sq1]
+                                 ^ zobristTable[384*color + 64*pieceID + sq2]
+                                 ^ zobristTable[768];
+
+                    // Insert, kicking out any previous entry to its other slot
+                    int i = cuckooH1(key);
+                    while (true) {
+                        std::swap(cuckooKeys[i], key);
+                        std::swap(cuckooMoves[i], m);
+                        if (m == NULL_MOVE)
+                            break;
+                        i = (i == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                    }
+                }
+            }
+        }
+    }
 }
 
 // Magic tables, initialized in bbinit.cpp
@@ -1197,6 +1256,21 @@ bool Board::isInCheck(int color) {
     return getAttackMap(color^1, sq);
 }
 
+// Given the Zobrist key difference between this position and a previous one,
+// returns true if a single reversible move by some piece that is not blocked
+// on this board connects the two positions.
+bool Board::isReversibleMoveKey(uint64_t moveKey) {
+    int i = cuckooH1(moveKey);
+    if (cuckooKeys[i] != moveKey) {
+        i = cuckooH2(moveKey);
+        if (cuckooKeys[i] != moveKey)
+            return false;
+    }
+
+    Move m = cuckooMoves[i];
+    return !(inBetweenSqs[getStartSq(m)][getEndSq(m)] & getOccupancy());
+}
+
 bool Board::isDraw() {
     if (fiftyMoveCounter >= 100) return true;
 
@@ -1336,6 +1410,92 @@ int Board::getSEEForMove(int color, Move m) {
     return value;
 }
 
+/**
+ * @brief Returns whether the SEE of a move is at least threshold. Only as much
+ * of the exchange as is needed to decide this is played out, and x-ray
+ * attackers are found by updating the slider attacks for the line the last
+ * capturing piece was on. Promotions and en passant are scored properly here,
+ * unlike in getSEEForMove().
+ */
+bool Board::seeGE(int color, Move m, int threshold) {
+    if (isCastle(m))
+        return 0 >= threshold;
+
+    int startSq = getStartSq(m);
+    int endSq = getEndSq(m);
+    uint64_t occ = (getOccupancy() ^ indexToBit(startSq)) | indexToBit(endSq);
+
+    // The value of what we gain immediately, and the piece left on the
+    // square for the opponent to capture
+    int value = 0;
+    int victim = getPieceOnSquare(color, startSq);
+    if (isEP(m)) {
+        value = SEE_PIECE_VALS[PAWNS];
+        occ ^= indexToBit((color == WHITE) ? endSq - 8 : endSq + 8);
+    }
+    else if (isCapture(m))
+        value = SEE_PIECE_VALS[getPieceOnSquare(color^1, endSq)];
+    if (isPromotion(m)) {
+        victim = getPromotion(m);
+        value += SEE_PIECE_VALS[victim] - SEE_PIECE_VALS[PAWNS];
+    }
+
+    // If even a free capture does not reach the threshold, we are done
+    int swap = value - threshold;
+    if (swap < 0)
+        return false;
+    // If we are still above the threshold after losing the piece, we are done
+    swap = SEE_PIECE_VALS[victim] - swap;
+    if (swap <= 0)
+        return true;
+
+    uint64_t diagonals = pieces[WHITE][BISHOPS] | pieces[BLACK][BISHOPS]
+                       | pieces[WHITE][QUEENS] | pieces[BLACK][QUEENS];
+    uint64_t straights = pieces[WHITE][ROOKS] | pieces[BLACK][ROOKS]
+                       | pieces[WHITE][QUEENS] | pieces[BLACK][QUEENS];
+    uint64_t attackers = (getWPawnCaptures(indexToBit(endSq)) & pieces[BLACK][PAWNS])
+                       | (getBPawnCaptures(indexToBit(endSq)) & pieces[WHITE][PAWNS])
+                       | (getKnightSquares(endSq) & (pieces[WHITE][KNIGHTS] | pieces[BLACK][KNIGHTS]))
+                       | (getBishopSquares(endSq, occ) & diagonals)
+                       | (getRookSquares(endSq, occ) & straights)
+                       | (getKingSquares(endSq) & (pieces[WHITE][KINGS] | pieces[BLACK][KINGS]));
+
+    // result is true if the side that made the move is currently winning the
+    // exchange. Each side recaptures with its least valuable attacker, and
+    // may stop when continuing can no longer change the result.
+    bool result = true;
+    while (true) {
+        color ^= 1;
+        attackers &= occ;
+        uint64_t ourAttackers = attackers & allPieces[color];
+        if (!ourAttackers)
+            break;
+
+        int piece = PAWNS;
+        while (!(ourAttackers & pieces[color][piece]))
+            piece++;
+        result = !result;
+
+        // The king can only recapture if the square is no longer defended
+        if (piece == KINGS)
+            return (attackers & allPieces[color^1]) ? !result : result;
+
+        swap = SEE_PIECE_VALS[piece] - swap;
+        if (swap < (int) result)
+            break;
+
+        uint64_t single = ourAttackers & pieces[color][piece];
+        occ ^= single & -single;
+        // Only the lines through the removed piece can reveal new attackers
+        if (piece == PAWNS || piece == BISHOPS || piece == QUEENS)
+            attackers |= getBishopSquares(endSq, occ) & diagonals;
+        if (piece == ROOKS || piece == QUEENS)
+            attackers |= getRookSquares(endSq, occ) & straights;
+    }
+
+    return result;
+}
+
 int Board::valueOfPiece(int pieceID) {
     switch(pieceID) {
         // EP capture
@@ -1366,6 +1526,13 @@ int Board::getMVVLVAScore(int color, Move m) {
     return (victim * 8) + (4 - attacker);
 }
 
+// MVV/LVA score when the moving and captured pieces are already known
+int Board::getMVVLVAScore(int attacker, int victim) {
+    if (attacker == KINGS)
+        attacker = -1;
+    return (victim * 8) + (4 - attacker);
+}
+
 // Returns a score from the initial capture
 // This helps reduce the number of times SEE must be used in quiescence search,
 // since if we have a losing trade after capture-recapture our opponent could
@@ -1555,3 +1722,105 @@ void Board::initZobristKey(int *mailbox) {
     zobristKey ^= zobristTable[769 + castlingRights];
     zobristKey ^= zobristTable[785 + epCaptureFile];
 }
+
+//------------------------------------------------------------------------------
+//----------------------------String conversions--------------------------------
+//------------------------------------------------------------------------------
+
+// Splits a string s with delimiter d.
+std::vector<std::string> split(const std::string &s, char d) {
+    std::vector<std::string> v;
+    std::stringstream ss(s);
+    std::string item;
+    while (getline(ss, item, d)) {
+        v.push_back(item);
+    }
+    return v;
+}
+
+Board fenToBoard(std::string s) {
+    std::vector<std::string> components = split(s, ' ');
+    std::vector<std::string> rows = split(components.at(0), '/');
+    int mailbox[64];
+    int sqCounter = -1;
+    std::string pieceString = "PNBRQKpnbrqk";
+
+    // iterate through rows backwards (because mailbox goes a1 -> h8), converting into mailbox format
+    for (int elem = 7; elem >= 0; elem--) {
+        std::string rowAtElem = rows.at(elem);
+
+        for (unsigned col = 0; col < rowAtElem.length(); col++) {
+            char sq = rowAtElem.at(col);
+            do mailbox[++sqCounter] = pieceString.find(sq--);
+            while ('0' < sq && sq < '8');
+        }
+    }
+
+    int playerToMove = (components.at(1) == "w") ? WHITE : BLACK;
+    bool whiteCanKCastle = (components.at(2).find("K") != std::string::npos);
+    bool whiteCanQCastle = (components.at(2).find("Q") != std::string::npos);
+    bool blackCanKCastle = (components.at(2).find("k") != std::string::npos);
+    bool blackCanQCastle = (components.at(2).find("q") != std::string::npos);
+    int epCaptureFile = (components.at(3) == "-") ? NO_EP_POSSIBLE
+        : components.at(3).at(0) - 'a';
+    int fiftyMoveCounter = (components.size() == 6) ? std::stoi(components.at(4)) : 0;
+    int moveNumber = (components.size() == 6) ? std::stoi(components.at(5)) : 1;
+    return Board(mailbox, whiteCanKCastle, blackCanKCastle, whiteCanQCastle,
+            blackCanQCastle, epCaptureFile, fiftyMoveCounter, moveNumber,
+            playerToMove);
+}
+
+std::string boardToFEN(Board &board) {
+    int *mailbox = board.getMailbox();
+    std::string pieceString = "PNBRQKpnbrqk";
+    std::string fenString;
+    int emptyCt = 0;
+
+    for (int r = 7; r >= 0; r--) {
+        for (int f = 0; f < 8; f++) {
+            int sq = 8*r + f;
+            if (mailbox[sq] == -1)
+                emptyCt++;
+            else {
+                if (emptyCt) {
+                    fenString += std::to_string(emptyCt);
+                    emptyCt = 0;
+                }
+                fenString += pieceString[mailbox[sq]];
+            }
+        }
+
+        if (emptyCt) {
+            fenString += std::to_string(emptyCt);
+            emptyCt = 0;
+        }
+        if (r != 0)
+            fenString += '/';
+    }
+
+    fenString += ' ';
+    fenString += (board.getPlayerToMove() == WHITE) ? 'w' : 'b';
+    fenString += ' ';
+    bool hasCastles = false;
+    if (board.getWhiteCanKCastle()) { hasCastles = true; fenString += 'K'; }
+    if (board.getWhiteCanQCastle()) { hasCastles = true; fenString += 'Q'; }
+    if (board.getBlackCanKCastle()) { hasCastles = true; fenString += 'k'; }
+    if (board.getBlackCanQCastle()) { hasCastles = true; fenString += 'q'; }
+    if (!hasCastles) fenString += '-';
+    fenString += ' ';
+
+    uint16_t epCaptureFile = board.getEPCaptureFile();
+    if (epCaptureFile == NO_EP_POSSIBLE)
+        fenString += '-';
+    else {
+        fenString += 'a' + epCaptureFile;
+        fenString += (board.getPlayerToMove() == WHITE) ? '6' : '3';
+    }
+
+    fenString += ' ';
+    fenString += std::to_string(board.getFiftyMoveCounter());
+    fenString += ' ';
+    fenString += std::to_string(board.getMoveNumber());
+
+    return fenString;
+}
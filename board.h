@@ -31,6 +31,9 @@ const uint8_t BLACKCASTLE = 0xC;
 
 const uint16_t NO_EP_POSSIBLE = 0x8;
 
+// Number of entries in the cuckoo tables used for upcoming repetition detection
+const int CUCKOO_SIZE = 8192;
+
 const bool MOVEGEN_CAPTURES = true;
 const bool MOVEGEN_QUIETS = false;
 
@@ -115,6 +118,7 @@ public:
     uint64_t getPinnedMap(int color);
 
     bool isInCheck(int color);
+    bool isReversibleMoveKey(uint64_t moveKey);
     bool isDraw();
     bool isInsufficientMaterial();
     void getCheckMaps(int color, uint64_t *checkMaps);
@@ -126,9 +130,11 @@ public:
     uint64_t getLeastValuableAttacker(uint64_t attackers, int color, int &piece);
     int getSEE(int color, int sq);
     int getSEEForMove(int color, Move m);
+    bool seeGE(int color, Move m, int threshold);
     int valueOfPiece(int piece);
     // Most Valuable Victim / Least Valuable Attacker
     int getMVVLVAScore(int color, Move m);
+    int getMVVLVAScore(int attacker, int victim);
     int getExchangeScore(int color, Move m);
 
     // Public move generators
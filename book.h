@@ -0,0 +1,70 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __BOOK_H__
+#define __BOOK_H__
+
+#include <random>
+#include <string>
+#include "board.h"
+#include "common.h"
+
+
+/*
+ * @brief An entry of a Polyglot book, as stored on disk. All fields are big
+ * endian.
+ * Size: 16 bytes
+ */
+struct PolyglotEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+uint64_t polyglotKey(Board &b);
+
+/*
+ * @brief A read-only Polyglot opening book. The file is memory mapped and the
+ * entries, which are sorted by key, are found with a binary search.
+ */
+class Book {
+private:
+    void *memory;
+    uint64_t mapSize;
+    const PolyglotEntry *entries;
+    uint64_t numEntries;
+    std::mt19937_64 rng;
+
+    uint64_t findFirst(uint64_t key);
+    Move toMove(Board &b, uint16_t pgMove);
+
+public:
+    Book();
+    Book(const Book &other) = delete;
+    Book& operator=(const Book &other) = delete;
+    ~Book();
+
+    bool open(std::string path);
+    void close();
+    bool isOpen() { return entries != nullptr; }
+
+    Move probe(Board &b, bool bestOnly);
+};
+
+#endif
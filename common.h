@@ -182,7 +182,21 @@ public:
     }
 };
 
+/*
+ * A move along with the information needed to order it, so that the moving
+ * and captured pieces only need to be found once.
+ * Size: 8 bytes
+ */
+struct ExtMove {
+    Move move;
+    // The moving piece, and the captured piece or -1 if there is none
+    int8_t pieceID;
+    int8_t captured;
+    int score;
+};
+
 typedef SearchArrayList<Move> MoveList;
 typedef SearchArrayList<int> ScoreList;
+typedef SearchArrayList<ExtMove> ExtMoveList;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "debuglog.h"
+
+// How long the writer sleeps when the buffer is empty, in ms
+const int LOG_POLL_INTERVAL = 5;
+
+struct LogSlot {
+    // Sequence number used to hand the slot between producers and the writer
+    std::atomic<uint64_t> sequence;
+    // Microseconds since the epoch
+    uint64_t time;
+    bool isInput;
+    unsigned int length;
+    char text[LOG_LINE_SIZE];
+};
+
+/*
+ * A bounded multi-producer, single-consumer ring buffer. A producer claims a
+ * slot by advancing enqueuePos, fills it in, and publishes it by setting the
+ * slot's sequence to one past its position. The writer frees the slot for the
+ * next lap by setting the sequence to position + LOG_BUFFER_LINES.
+ */
+struct LogBuffer {
+    LogSlot slots[LOG_BUFFER_LINES];
+    std::atomic<uint64_t> enqueuePos;
+    uint64_t dequeuePos;
+    std::atomic<uint64_t> dropped;
+    // Guards the file and dequeuePos, for the writer thread and closeDebugLog()
+    std::mutex fileMutex;
+    std::ofstream file;
+};
+
+// Allocated on first use and never freed, so that the detached writer thread
+// can still use it while the program exits
+static LogBuffer *logBuffer = nullptr;
+static std::once_flag logFlag;
+static std::atomic<bool> logEnabled(false);
+
+void runLogWriter();
+
+void initDebugLog() {
+    logBuffer = new LogBuffer();
+    for (unsigned int i = 0; i < LOG_BUFFER_LINES; i++)
+        logBuffer->slots[i].sequence.store(i, std::memory_order_relaxed);
+    logBuffer->enqueuePos = 0;
+    logBuffer->dequeuePos = 0;
+    logBuffer->dropped = 0;
+    std::thread(runLogWriter).detach();
+}
+
+void logLine(const std::string &line, bool isInput) {
+    if (!logEnabled.load(std::memory_order_relaxed))
+        return;
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    LogSlot *slot;
+    uint64_t pos = logBuffer->enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        slot = &logBuffer->slots[pos & (LOG_BUFFER_LINES - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == pos) {
+            if (logBuffer->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        // The writer has not freed this slot yet, so the buffer is full
+        else if (sequence < pos) {
+            logBuffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+            pos = logBuffer->enqueuePos.load(std::memory_order_relaxed);
+    }
+
+    slot->time = time;
+    slot->isInput = isInput;
+    slot->length = std::min((unsigned int) line.size(), LOG_LINE_SIZE);
+    std::memcpy(slot->text, line.data(), slot->length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void logInput(const std::string &line) {
+    logLine(line, true);
+}
+
+void logOutput(const std::string &line) {
+    logLine(line, false);
+}
+
+// Formats a timestamp as local time with microseconds
+std::string timeToString(uint64_t micros) {
+    std::time_t seconds = (std::time_t) (micros / 1000000);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+    char fraction[8];
+    std::snprintf(fraction, sizeof(fraction), ".%06u", (unsigned int) (micros % 1000000));
+    return std::string(buffer) + fraction;
+}
+
+// Writes out all published lines. Returns false if there were none.
+bool drainLog() {
+    bool wroteAny = false;
+    std::lock_guard<std::mutex> lock(logBuffer->fileMutex);
+    while (true) {
+        LogSlot *slot = &logBuffer->slots[logBuffer->dequeuePos & (LOG_BUFFER_LINES - 1)];
+        if (slot->sequence.load(std::memory_order_acquire) != logBuffer->dequeuePos + 1)
+            break;
+        if (logBuffer->file.is_open()) {
+            logBuffer->file << timeToString(slot->time) << (slot->isInput ? " >> " : " << ");
+            logBuffer->file.write(slot->text, slot->length);
+            logBuffer->file << '\n';
+        }
+        slot->sequence.store(logBuffer->dequeuePos + LOG_BUFFER_LINES, std::memory_order_release);
+        logBuffer->dequeuePos++;
+        wroteAny = true;
+    }
+
+    uint64_t dropped = logBuffer->dropped.exchange(0);
+    if (dropped > 0 && logBuffer->file.is_open())
+        logBuffer->file << "[" << dropped << " lines dropped]\n";
+    if (wroteAny)
+        logBuffer->file.flush();
+    return wroteAny;
+}
+
+void runLogWriter() {
+    while (true) {
+        if (!drainLog())
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_POLL_INTERVAL));
+    }
+}
+
+bool openDebugLog(const std::string &path) {
+    std::call_once(logFlag, initDebugLog);
+    closeDebugLog();
+    std::lock_guard<std::mutex> lock(logBuffer->fileMutex);
+    logBuffer->file.open(path, std::ios::app);
+    if (!logBuffer->file.is_open())
+        return false;
+    logEnabled = true;
+    return true;
+}
+
+void closeDebugLog() {
+    if (logBuffer == nullptr)
+        return;
+    logEnabled = false;
+    // Lines being added as logging was turned off may still be published
+    // after this drain, and are then discarded
+    drainLog();
+    std::lock_guard<std::mutex> lock(logBuffer->fileMutex);
+    if (logBuffer->file.is_open())
+        logBuffer->file.close();
+}
@@ -0,0 +1,41 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DEBUGLOG_H__
+#define __DEBUGLOG_H__
+
+#include <string>
+
+// Number of lines the log buffer holds. Must be a power of two.
+const unsigned int LOG_BUFFER_LINES = 4096;
+// Longer lines are truncated
+const unsigned int LOG_LINE_SIZE = 1024;
+
+/*
+ * The debug log records the UCI conversation with microsecond timestamps.
+ * Lines are put in a lock-free ring buffer and written to the file by a
+ * background thread, so logging never blocks the caller. If the buffer is
+ * full, lines are dropped, and the number dropped is written to the log.
+ */
+bool openDebugLog(const std::string &path);
+// Writes all buffered lines and closes the file
+void closeDebugLog();
+void logInput(const std::string &line);
+void logOutput(const std::string &line);
+
+#endif
@@ -0,0 +1,274 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "bbinit.h"
+#include "engine.h"
+#include "eval.h"
+#include "uci.h"
+
+// Declared in search.cpp
+extern std::atomic<bool> isStop;
+extern std::atomic<bool> stopSignal;
+
+// The instance whose search is running, if any. Guarded by searchMutex.
+static Engine *activeEngine = nullptr;
+static std::mutex searchMutex;
+static std::once_flag initFlag;
+
+// One-time initialization of the tables used by all instances, as done at
+// startup by the UCI interface
+static void initEngine() {
+    initMagicTables(2563762638929852183ULL);
+    initPSQT();
+    initZobristTable();
+    initInBetweenTable();
+    initPerThreadMemory();
+
+    setMultiPV(DEFAULT_MULTI_PV);
+    setNumThreads(DEFAULT_THREADS);
+}
+
+Engine::Engine() {
+    std::call_once(initFlag, initEngine);
+    board = fenToBoard(STARTPOS);
+    bufferTime = DEFAULT_BUFFER_TIME;
+}
+
+Engine::~Engine() {
+    stop();
+    wait();
+}
+
+//------------------------------------------------------------------------------
+//-------------------------------Position setup---------------------------------
+//------------------------------------------------------------------------------
+
+bool Engine::setPosition(const std::string &fen, const std::vector<std::string> &moves) {
+    Board b;
+    try {
+        b = fenToBoard(fen);
+    }
+    catch (const std::exception &e) {
+        return false;
+    }
+    // The search requires exactly one king per side
+    if (count(b.getPieces(WHITE, KINGS)) != 1 || count(b.getPieces(BLACK, KINGS)) != 1)
+        return false;
+
+    // Replay the moves on a copy so that nothing changes on failure
+    std::swap(board, b);
+    std::vector<uint64_t> oldHistory;
+    std::swap(history, oldHistory);
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        if (!makeMove(moves[i])) {
+            std::swap(board, b);
+            std::swap(history, oldHistory);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Engine::setPosition(const std::string &fen) {
+    return setPosition(fen, std::vector<std::string>());
+}
+
+bool Engine::makeMove(const std::string &move) {
+    Move m = findMove(move);
+    if (m == NULL_MOVE)
+        return false;
+
+    int color = board.getPlayerToMove();
+    bool isPawnMove = board.getPieceOnSquare(color, getStartSq(m)) == PAWNS;
+
+    // Record positions for two-fold detection. Captures, pawn moves, and
+    // castles are irreversible, so earlier positions can no longer repeat.
+    history.push_back(board.getZobristKey());
+    if (isCapture(m) || isPawnMove || isCastle(m))
+        history.clear();
+
+    board.doMove(m, color);
+    return true;
+}
+
+std::string Engine::getFEN() {
+    return boardToFEN(board);
+}
+
+Board &Engine::getBoard() {
+    return board;
+}
+
+// Returns the legal move matching a move in long algebraic notation, or
+// NULL_MOVE if there is none
+Move Engine::findMove(const std::string &move) {
+    MoveList legalMoves = board.getAllLegalMoves(board.getPlayerToMove());
+    for (unsigned int i = 0; i < legalMoves.size(); i++) {
+        if (moveToString(legalMoves.get(i)) == move)
+            return legalMoves.get(i);
+    }
+    return NULL_MOVE;
+}
+
+int Engine::evaluate() {
+    Eval e;
+    int score = e.evaluate(board);
+    if (board.getPlayerToMove() == BLACK)
+        score = -score;
+    return score * 100 / PIECE_VALUES[EG][PAWNS];
+}
+
+//------------------------------------------------------------------------------
+//-----------------------------------Search-------------------------------------
+//------------------------------------------------------------------------------
+
+bool Engine::go(const SearchLimits &limits, InfoHandler onInfoFn, BestMoveHandler onBestMoveFn) {
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine != nullptr)
+        return false;
+    // Our previous search, if any, has finished reporting
+    if (searchThread.joinable())
+        searchThread.join();
+
+    movesToSearch.clear();
+    for (unsigned int i = 0; i < limits.searchMoves.size(); i++) {
+        Move m = findMove(limits.searchMoves[i]);
+        if (m == NULL_MOVE)
+            return false;
+        movesToSearch.add(m);
+    }
+
+    // Same priority of limits as the UCI go command
+    if (limits.movetime > 0) {
+        timeParams.searchMode = MOVETIME;
+        timeParams.allotment = limits.movetime;
+    }
+    else if (limits.depth > 0) {
+        timeParams.searchMode = DEPTH;
+        timeParams.allotment = std::min(MAX_DEPTH, limits.depth);
+    }
+    else if (!limits.infinite && (limits.wtime > 0 || limits.btime > 0)) {
+        bool white = (board.getPlayerToMove() == WHITE);
+        allocateTime(&timeParams, white ? limits.wtime : limits.btime,
+            white ? limits.winc : limits.binc, limits.movestogo,
+            board.getMoveNumber(), bufferTime);
+    }
+    else {
+        timeParams.searchMode = DEPTH;
+        timeParams.allotment = MAX_DEPTH;
+    }
+
+    // Hand the position and game history to the shared search
+    searchBoard = board.staticCopy();
+    TwoFoldStack *twoFoldPositions = getTwoFoldStackPointer();
+    twoFoldPositions->clear();
+    twoFoldPositions->reserve(history.size() + 2 * MAX_DEPTH);
+    for (unsigned int i = 0; i < history.size(); i++)
+        twoFoldPositions->push(history[i]);
+
+    infoHandler = onInfoFn;
+    bestMoveHandler = onBestMoveFn;
+    setSearchCallbacks(onInfo, onBestMove, this);
+    activeEngine = this;
+
+    isStop = false;
+    stopSignal = false;
+    searchThread = std::thread(&Engine::runSearch, this);
+    return true;
+}
+
+void Engine::runSearch() {
+    getBestMove(&searchBoard, &timeParams, &movesToSearch);
+
+    std::lock_guard<std::mutex> lock(searchMutex);
+    setSearchCallbacks(nullptr, nullptr, nullptr);
+    activeEngine = nullptr;
+}
+
+void Engine::stop() {
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine == this) {
+        isStop = true;
+        stopSignal = true;
+    }
+}
+
+// Blocks until our search has finished. This must not be called from inside
+// a handler, which runs on the search thread.
+void Engine::wait() {
+    if (searchThread.joinable())
+        searchThread.join();
+}
+
+bool Engine::isSearching() {
+    std::lock_guard<std::mutex> lock(searchMutex);
+    return activeEngine == this;
+}
+
+void Engine::onInfo(const SearchInfo &info, void *data) {
+    Engine *engine = static_cast<Engine *>(data);
+    if (engine->infoHandler)
+        engine->infoHandler(info);
+}
+
+void Engine::onBestMove(Move bestMove, Move ponder, void *data) {
+    Engine *engine = static_cast<Engine *>(data);
+    if (engine->bestMoveHandler)
+        engine->bestMoveHandler(bestMove, ponder);
+}
+
+//------------------------------------------------------------------------------
+//-----------------------------------Options------------------------------------
+//------------------------------------------------------------------------------
+
+// Clearing the tables during a search would corrupt it, so this waits for any
+// search to finish first.
+void Engine::newGame() {
+    wait();
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine == nullptr)
+        clearTables();
+}
+
+void Engine::setThreads(int n) {
+    std::call_once(initFlag, initEngine);
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine == nullptr)
+        setNumThreads(std::max(MIN_THREADS, std::min(MAX_THREADS, n)));
+}
+
+void Engine::setHashSize(uint64_t MB) {
+    std::call_once(initFlag, initEngine);
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine == nullptr)
+        ::setHashSize(std::max(MIN_HASH_SIZE, std::min(MAX_HASH_SIZE, MB)));
+}
+
+void Engine::setMultiPV(unsigned int n) {
+    std::call_once(initFlag, initEngine);
+    std::lock_guard<std::mutex> lock(searchMutex);
+    if (activeEngine == nullptr)
+        ::setMultiPV(std::max((unsigned int) MIN_MULTI_PV, std::min((unsigned int) MAX_MULTI_PV, n)));
+}
+
+void Engine::setBufferTime(int ms) {
+    bufferTime = std::max(MIN_BUFFER_TIME, std::min(MAX_BUFFER_TIME, ms));
+}
@@ -0,0 +1,122 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "common.h"
+#include "search.h"
+#include "timeman.h"
+
+/*
+ * @brief Limits for a search started with Engine::go(). A value of 0 means the
+ * limit is not set. The first limit set out of movetime, depth, and the game
+ * clock is used, as with the UCI go command. If no limit is set, or if infinite
+ * is true, the search runs until stop() is called.
+ */
+struct SearchLimits {
+    int depth;
+    int movetime;
+    int wtime;
+    int btime;
+    int winc;
+    int binc;
+    int movestogo;
+    bool infinite;
+    // Only search these moves, in long algebraic notation, if nonempty
+    std::vector<std::string> searchMoves;
+
+    SearchLimits() {
+        depth = movetime = 0;
+        wtime = btime = winc = binc = movestogo = 0;
+        infinite = false;
+    }
+};
+
+/*
+ * @brief An embeddable engine instance, as an alternative to talking UCI over
+ * a pipe. Each instance has its own position, game history, and callbacks.
+ *
+ * The search itself, along with the hash table and thread count, is shared by
+ * all instances in a process, so only one instance can search at a time.
+ * go() returns false if another search is running.
+ */
+class Engine {
+public:
+    typedef std::function<void(const SearchInfo &info)> InfoHandler;
+    typedef std::function<void(Move bestMove, Move ponder)> BestMoveHandler;
+
+    Engine();
+    Engine(const Engine &other) = delete;
+    Engine& operator=(const Engine &other) = delete;
+    ~Engine();
+
+    // Position setup. These return false and leave the position unchanged if
+    // the FEN or a move is invalid.
+    bool setPosition(const std::string &fen, const std::vector<std::string> &moves);
+    bool setPosition(const std::string &fen);
+    bool makeMove(const std::string &move);
+    std::string getFEN();
+    Board &getBoard();
+
+    // Static evaluation in centipawns, from the side to move's point of view
+    int evaluate();
+
+    // Searches asynchronously. The info handler is called as each iteration
+    // finishes and the best move handler once at the end, both on the search
+    // thread. A NULL_MOVE best move means there are no legal moves.
+    bool go(const SearchLimits &limits, InfoHandler onInfo, BestMoveHandler onBestMove);
+    void stop();
+    void wait();
+    bool isSearching();
+
+    // Clears the hash table and history, as for a new game
+    void newGame();
+
+    // Process-wide settings, shared with all other instances
+    static void setThreads(int n);
+    static void setHashSize(uint64_t MB);
+    static void setMultiPV(unsigned int n);
+    void setBufferTime(int ms);
+
+private:
+    Board board;
+    // Zobrist keys of positions since the last irreversible move
+    std::vector<uint64_t> history;
+    int bufferTime;
+
+    // Copies owned by the running search
+    Board searchBoard;
+    TimeManagement timeParams;
+    MoveList movesToSearch;
+    InfoHandler infoHandler;
+    BestMoveHandler bestMoveHandler;
+    std::thread searchThread;
+
+    Move findMove(const std::string &move);
+    void runSearch();
+    static void onInfo(const SearchInfo &info, void *data);
+    static void onBestMove(Move bestMove, Move ponder, void *data);
+};
+
+#endif
@@ -24,27 +24,40 @@ EvalHash::EvalHash(uint64_t MB) {
 }
 
 EvalHash::~EvalHash() {
-    free(table);
+    free(memory);
 }
 
 // Adds key and move into the hashtable. This function assumes that the key has
 // been checked with get and is not in the table.
 void EvalHash::add(Board &b, int score) {
-    // Use the lower 32 bits of the hash key to index the array
-    uint32_t h = (uint32_t) (b.getZobristKey() & 0xFFFFFFFF);
-    uint32_t index = h & (size-1);
-
-    table[index].setEntry(b, score);
+    uint64_t h = b.getZobristKey();
+    EvalHashBucket *bucket = table + (h & (size-1));
+    uint32_t check = (uint32_t) (h >> 32);
+
+    // Find the entry to replace: either the same position, or the oldest
+    // entry at the back of the bucket
+    int i = 0;
+    for (; i < EVAL_HASH_BUCKET_SIZE - 1; i++) {
+        if ((bucket->slots[i].zobristKey ^ bucket->slots[i].score) == check)
+            break;
+    }
+
+    // Shift newer entries back to make room at the front
+    for (; i > 0; i--)
+        bucket->slots[i] = bucket->slots[i-1];
+    bucket->slots[0].setEntry(b, score);
 }
 
 // Get the hash entry, if any, associated with a board b.
 int EvalHash::get(Board &b) {
-    // Use the lower 32 bits of the hash key to index the array
-    uint32_t h = (uint32_t) (b.getZobristKey() & 0xFFFFFFFF);
-    uint32_t index = h & (size-1);
+    uint64_t h = b.getZobristKey();
+    EvalHashBucket *bucket = table + (h & (size-1));
+    uint32_t check = (uint32_t) (h >> 32);
 
-    if ((table[index].zobristKey ^ table[index].score) == (uint32_t) (b.getZobristKey() >> 32))
-        return table[index].score;
+    for (int i = 0; i < EVAL_HASH_BUCKET_SIZE; i++) {
+        if ((bucket->slots[i].zobristKey ^ bucket->slots[i].score) == check)
+            return bucket->slots[i].score;
+    }
 
     // Because of the offset, 0 will not be a valid returned score. Thus we can use
     // this to indicate no match found.
@@ -52,26 +65,31 @@ int EvalHash::get(Board &b) {
 }
 
 void EvalHash::setSize(uint64_t MB) {
-    free(table);
+    free(memory);
     init(MB);
 }
 
 void EvalHash::init(uint64_t MB) {
     // Convert to bytes
     uint64_t bytes = MB << 20;
-    // Calculate how many array slots we can use
-    uint64_t maxSize = bytes / sizeof(EvalHashEntry);
+    // Calculate how many buckets we can use
+    uint64_t maxSize = bytes / sizeof(EvalHashBucket);
 
     size = 1;
     while (size <= maxSize)
         size <<= 1;
     size >>= 1;
 
-    table = (EvalHashEntry *) calloc(size, sizeof(EvalHashEntry));
+    // Allocate one extra bucket so that the table can start on a bucket
+    // boundary, keeping each bucket within a single cache line
+    memory = calloc(size + 1, sizeof(EvalHashBucket));
+    uintptr_t start = ((uintptr_t) memory + sizeof(EvalHashBucket) - 1)
+                    & ~((uintptr_t) sizeof(EvalHashBucket) - 1);
+    table = (EvalHashBucket *) start;
     keys = 0;
 }
 
 void EvalHash::clear() {
-    std::memset(table, 0, size * sizeof(EvalHashEntry));
+    std::memset(table, 0, size * sizeof(EvalHashBucket));
     keys = 0;
 }
@@ -26,6 +26,10 @@
 // Offset so that we can always store a positive value in EvalHashEntry
 const int EVAL_HASH_OFFSET = (1 << 20);
 
+// Number of entries in each bucket of the eval cache. 4 entries fill half of a
+// 64-byte cache line.
+const int EVAL_HASH_BUCKET_SIZE = 4;
+
 /*
  * @brief Struct storing hashed eval information
  * Size: 8 bytes
@@ -51,9 +55,20 @@ struct EvalHashEntry {
     ~EvalHashEntry() {}
 };
 
+/*
+ * @brief A bucket of eval cache entries. New entries are inserted at the
+ * front, and the oldest entry at the back is evicted when the bucket is full.
+ * Size: 32 bytes
+ */
+struct EvalHashBucket {
+    EvalHashEntry slots[EVAL_HASH_BUCKET_SIZE];
+};
+
 class EvalHash {
 private:
-    EvalHashEntry *table;
+    // Raw allocation, so that the table can be aligned to bucket boundaries
+    void *memory;
+    EvalHashBucket *table;
     uint64_t size;
 
     void init(uint64_t MB);
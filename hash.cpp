@@ -23,17 +23,20 @@
  * Packs the data into a single 64-bit integer using the following format:
  * Bits 0-15: score
  * Bits 16-31: move
- * Bits 32-39: node type
- * Bits 40-47: age
+ * Bits 32-47: static eval (INFTY if not available)
  * Bits 48-55: depth
+ * Bits 56-57: node type
+ * Bits 58-63: age
  */
-uint64_t packHashData(int depth, Move m, int score, uint8_t nodeType, uint8_t age) {
+uint64_t packHashData(int depth, Move m, int score, int staticEval, uint8_t nodeType, uint8_t age) {
     uint64_t data = 0;
-    data |= (uint8_t) depth;
-    data <<= 8;
-    data |= age;
-    data <<= 8;
+    data |= (age & HASH_AGE_MASK);
+    data <<= 2;
     data |= nodeType;
+    data <<= 8;
+    data |= (uint8_t) depth;
+    data <<= 16;
+    data |= (uint16_t) staticEval;
     data <<= 16;
     data |= m;
     data <<= 16;
@@ -69,9 +72,9 @@ void Hash::add(Board &b, uint64_t data, int depth, uint8_t age) {
     // entry with the new entry if the new entry's depth is high enough
     else {
         HashEntry *toReplace = &(node->slot1);
-        int score1 = 128*((int) (age - getHashAge(node->slot1.data)))
+        int score1 = 128*((int) ((age - getHashAge(node->slot1.data)) & HASH_AGE_MASK))
             + depth - getHashDepth(node->slot1.data);
-        int score2 = 128*((int) (age - getHashAge(node->slot2.data)))
+        int score2 = 128*((int) ((age - getHashAge(node->slot2.data)) & HASH_AGE_MASK))
             + depth - getHashDepth(node->slot2.data);
         if (score1 < score2)
             toReplace = &(node->slot2);
@@ -123,6 +126,7 @@ void Hash::clear() {
 }
 
 int Hash::estimateHashfull(uint8_t age) {
+    age &= HASH_AGE_MASK;
     int used = 0;
     // This will never go out of bounds since a 1 MB table has 32768 slots
     for (int i = 0; i < 500; i++) {
@@ -27,9 +27,12 @@ const uint8_t CUT_NODE = 1;
 const uint8_t ALL_NODE = 2;
 const uint8_t NO_NODE_INFO = 3;
 
+// Only the lowest 6 bits of the search age are stored in each entry
+const uint8_t HASH_AGE_MASK = 0x3F;
+
 
 // Pack the information stored in a hash entry into a single 64-bit integer
-uint64_t packHashData(int depth, Move m, int score, uint8_t nodeType, uint8_t age);
+uint64_t packHashData(int depth, Move m, int score, int staticEval, uint8_t nodeType, uint8_t age);
 
 // Functions for unpacking hash data
 inline int getHashDepth(uint64_t data) {
@@ -44,12 +47,17 @@ inline int getHashScore(uint64_t data) {
     return (int16_t) (data & 0xFFFF);
 }
 
+// Returns INFTY if no static eval was stored with this entry
+inline int getHashEval(uint64_t data) {
+    return (int16_t) ((data >> 32) & 0xFFFF);
+}
+
 inline uint8_t getHashAge(uint64_t data) {
-    return (data >> 40) & 0xFF;
+    return (data >> 58) & HASH_AGE_MASK;
 }
 
 inline uint8_t getHashNodeType(uint64_t data) {
-    return (data >> 32) & 0x3;
+    return (data >> 56) & 0x3;
 }
 
 /*
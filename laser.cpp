@@ -0,0 +1,136 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "engine.h"
+#include "laser.h"
+
+struct LaserEngine {
+    Engine engine;
+};
+
+LaserEngine *laser_engine_new(void) {
+    return new LaserEngine();
+}
+
+void laser_engine_free(LaserEngine *engine) {
+    delete engine;
+}
+
+int laser_set_fen(LaserEngine *engine, const char *fen) {
+    return engine->engine.setPosition(fen);
+}
+
+int laser_set_position(LaserEngine *engine, const char *fen, const char **moves, int numMoves) {
+    std::vector<std::string> moveList(moves, moves + numMoves);
+    return engine->engine.setPosition(fen, moveList);
+}
+
+int laser_make_move(LaserEngine *engine, const char *move) {
+    return engine->engine.makeMove(move);
+}
+
+void laser_get_fen(LaserEngine *engine, char *buf, int size) {
+    if (size <= 0)
+        return;
+    std::string fen = engine->engine.getFEN();
+    std::strncpy(buf, fen.c_str(), size - 1);
+    buf[size-1] = '\0';
+}
+
+int laser_evaluate(LaserEngine *engine) {
+    return engine->engine.evaluate();
+}
+
+int laser_go(LaserEngine *engine, const LaserLimits *limits,
+        LaserInfoCallback onInfo, LaserBestMoveCallback onBestMove, void *user) {
+    SearchLimits searchLimits;
+    if (limits != NULL) {
+        searchLimits.depth = limits->depth;
+        searchLimits.movetime = limits->movetime;
+        searchLimits.wtime = limits->wtime;
+        searchLimits.btime = limits->btime;
+        searchLimits.winc = limits->winc;
+        searchLimits.binc = limits->binc;
+        searchLimits.movestogo = limits->movestogo;
+        searchLimits.infinite = limits->infinite;
+    }
+
+    Engine::InfoHandler infoHandler;
+    if (onInfo != NULL) {
+        infoHandler = [onInfo, user](const SearchInfo &info) {
+            std::string pv;
+            for (int i = 0; i < info.pvLength; i++)
+                pv += (i ? " " : "") + moveToString(info.pv[i]);
+
+            LaserInfo laserInfo;
+            laserInfo.depth = info.depth;
+            laserInfo.seldepth = info.selDepth;
+            laserInfo.multipv = info.multiPV;
+            laserInfo.bound = info.bound;
+            laserInfo.is_mate = info.isMate;
+            laserInfo.score = info.score;
+            laserInfo.time = info.time;
+            laserInfo.nodes = info.nodes;
+            laserInfo.nps = info.nps;
+            laserInfo.tbhits = info.tbhits;
+            laserInfo.hashfull = info.hashfull;
+            laserInfo.pv = pv.c_str();
+            onInfo(&laserInfo, user);
+        };
+    }
+
+    Engine::BestMoveHandler bestMoveHandler;
+    if (onBestMove != NULL) {
+        bestMoveHandler = [onBestMove, user](Move bestMove, Move ponder) {
+            std::string best = (bestMove == NULL_MOVE) ? "none" : moveToString(bestMove);
+            std::string ponderStr = moveToString(ponder);
+            onBestMove(best.c_str(), (ponder == NULL_MOVE) ? NULL : ponderStr.c_str(), user);
+        };
+    }
+
+    return engine->engine.go(searchLimits, infoHandler, bestMoveHandler);
+}
+
+void laser_stop(LaserEngine *engine) {
+    engine->engine.stop();
+}
+
+void laser_wait(LaserEngine *engine) {
+    engine->engine.wait();
+}
+
+int laser_is_searching(LaserEngine *engine) {
+    return engine->engine.isSearching();
+}
+
+void laser_new_game(LaserEngine *engine) {
+    engine->engine.newGame();
+}
+
+void laser_set_threads(int threads) {
+    Engine::setThreads(threads);
+}
+
+void laser_set_hash(uint64_t MB) {
+    Engine::setHashSize(MB);
+}
+
+void laser_set_multipv(int multiPV) {
+    Engine::setMultiPV(multiPV < 1 ? 1 : multiPV);
+}
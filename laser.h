@@ -0,0 +1,105 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * C interface to liblaser.a, a thin wrapper around the Engine class in
+ * engine.h. Functions returning int return 1 on success and 0 on failure.
+ * Moves are strings in long algebraic notation, e.g. "e2e4" or "e7e8q".
+ * The library is C++, so programs must also link the C++ standard library
+ * and pthreads.
+ */
+
+#ifndef __LASER_H__
+#define __LASER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LaserEngine LaserEngine;
+
+/* Score bounds, matching the BOUND_* constants in search.h */
+#define LASER_BOUND_NONE  0
+#define LASER_BOUND_EXACT 1
+#define LASER_BOUND_UPPER 2
+#define LASER_BOUND_LOWER 3
+
+typedef struct {
+    int depth;
+    int seldepth;
+    int multipv;
+    int bound;
+    /* Score in centipawns, or in moves to mate if is_mate is set */
+    int is_mate;
+    int score;
+    uint64_t time;
+    uint64_t nodes;
+    uint64_t nps;
+    uint64_t tbhits;
+    int hashfull;
+    /* Space separated moves, only valid during the callback */
+    const char *pv;
+} LaserInfo;
+
+/* Limits as in the UCI go command. Zero fields are unset. */
+typedef struct {
+    int depth;
+    int movetime;
+    int wtime;
+    int btime;
+    int winc;
+    int binc;
+    int movestogo;
+    int infinite;
+} LaserLimits;
+
+/* Callbacks run on the search thread. bestmove is "none" if there are no legal
+   moves, and ponder is NULL if there is no ponder move. */
+typedef void (*LaserInfoCallback)(const LaserInfo *info, void *user);
+typedef void (*LaserBestMoveCallback)(const char *bestmove, const char *ponder, void *user);
+
+LaserEngine *laser_engine_new(void);
+void laser_engine_free(LaserEngine *engine);
+
+int laser_set_fen(LaserEngine *engine, const char *fen);
+int laser_set_position(LaserEngine *engine, const char *fen, const char **moves, int numMoves);
+int laser_make_move(LaserEngine *engine, const char *move);
+/* Writes the FEN of the current position into buf, truncated to size bytes */
+void laser_get_fen(LaserEngine *engine, char *buf, int size);
+int laser_evaluate(LaserEngine *engine);
+
+/* Only one engine in the process can search at a time */
+int laser_go(LaserEngine *engine, const LaserLimits *limits,
+    LaserInfoCallback onInfo, LaserBestMoveCallback onBestMove, void *user);
+void laser_stop(LaserEngine *engine);
+void laser_wait(LaserEngine *engine);
+int laser_is_searching(LaserEngine *engine);
+void laser_new_game(LaserEngine *engine);
+
+/* Process-wide settings */
+void laser_set_threads(int threads);
+void laser_set_hash(uint64_t MB);
+void laser_set_multipv(int multiPV);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
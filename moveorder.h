@@ -37,13 +37,18 @@ struct MoveOrder {
     SearchStackInfo *ssi;
     MoveGenStage mgStage;
     Move hashed;
-    MoveList legalMoves;
-    ScoreList scores;
+    ExtMoveList moves;
     unsigned int quietStart;
+    // Moves before scoredEnd have been scored, and during the quiet stage,
+    // moves before sortedEnd are already in order
+    unsigned int scoredEnd;
+    unsigned int sortedEnd;
     unsigned int index;
+    // The piece moved by the last move returned by nextMove()
+    int currentPiece;
 
     MoveOrder(Board *_b, int _color, int _depth, bool _isPVNode,
-        SearchParameters *_searchParams, SearchStackInfo *_ssi, Move _hashed, MoveList _legalMoves);
+        SearchParameters *_searchParams, SearchStackInfo *_ssi, Move _hashed, MoveList &_legalMoves);
 
     void generateMoves();
     Move nextMove();
@@ -53,6 +58,8 @@ private:
     void scoreCaptures();
     void scoreQuiets();
     void findQuietStart();
+    unsigned int pickBest(unsigned int start, unsigned int end);
+    unsigned int partialInsertionSort(unsigned int start, unsigned int end, int limit);
 };
 
 #endif
\ No newline at end of file
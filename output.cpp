@@ -0,0 +1,207 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "debuglog.h"
+#include "output.h"
+
+// Types of queued output
+const int OUTPUT_LINE = 0;
+const int OUTPUT_INFO = 1;
+const int OUTPUT_CURRMOVE = 2;
+const int OUTPUT_FLUSH = 3;
+
+struct OutputEntry {
+    int type;
+    uint64_t id;
+    std::string text;
+    SearchInfo info;
+    bool showMultiPV;
+    Move currMove;
+    unsigned int currMoveNumber;
+};
+
+// State shared between the writer thread and everyone queueing output. It is
+// never freed, so the detached writer thread can outlive main().
+struct OutputQueue {
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable flushed;
+    std::deque<OutputEntry> entries;
+    uint64_t nextID;
+    // All entries up to this one have been written
+    uint64_t flushedID;
+    int infoInterval;
+};
+
+static OutputQueue *outputQueue = nullptr;
+static std::once_flag outputFlag;
+
+void runWriter();
+
+void initOutput() {
+    outputQueue = new OutputQueue();
+    outputQueue->nextID = 1;
+    outputQueue->flushedID = 0;
+    outputQueue->infoInterval = DEFAULT_INFO_INTERVAL;
+    std::thread(runWriter).detach();
+}
+
+// Adds an entry to the queue and returns its ID
+uint64_t queueOutput(OutputEntry &entry) {
+    std::call_once(outputFlag, initOutput);
+    std::lock_guard<std::mutex> lock(outputQueue->mutex);
+    entry.id = outputQueue->nextID++;
+    outputQueue->entries.push_back(std::move(entry));
+    outputQueue->queued.notify_one();
+    return outputQueue->nextID - 1;
+}
+
+void writeLine(const std::string &line) {
+    OutputEntry entry;
+    entry.type = OUTPUT_LINE;
+    entry.text = line;
+    queueOutput(entry);
+}
+
+void writeInfo(const SearchInfo &info, bool showMultiPV) {
+    OutputEntry entry;
+    entry.type = OUTPUT_INFO;
+    entry.info = info;
+    entry.showMultiPV = showMultiPV;
+    queueOutput(entry);
+}
+
+void writeCurrMove(int depth, Move m, unsigned int moveNumber, uint64_t nodes, uint64_t nps) {
+    OutputEntry entry;
+    entry.type = OUTPUT_CURRMOVE;
+    entry.info.depth = depth;
+    entry.info.nodes = nodes;
+    entry.info.nps = nps;
+    entry.currMove = m;
+    entry.currMoveNumber = moveNumber;
+    queueOutput(entry);
+}
+
+void flushOutput() {
+    OutputEntry entry;
+    entry.type = OUTPUT_FLUSH;
+    uint64_t id = queueOutput(entry);
+    std::unique_lock<std::mutex> lock(outputQueue->mutex);
+    outputQueue->flushed.wait(lock, [id] { return outputQueue->flushedID >= id; });
+}
+
+void setInfoInterval(int ms) {
+    std::call_once(outputFlag, initOutput);
+    std::lock_guard<std::mutex> lock(outputQueue->mutex);
+    outputQueue->infoInterval = ms;
+}
+
+// Adds a line to the output, and to the debug log
+void appendLine(std::string &out, const std::string &line) {
+    out += line + "\n";
+    logOutput(line);
+}
+
+// Appends the held info lines to the output, in MultiPV order
+void writeHeldInfo(std::map<unsigned int, OutputEntry> &held, std::string &out,
+        ChessTime &lastInfo) {
+    if (held.empty())
+        return;
+    for (std::map<unsigned int, OutputEntry>::iterator it = held.begin(); it != held.end(); ++it)
+        appendLine(out, infoToString(it->second.info, it->second.showMultiPV));
+    held.clear();
+    lastInfo = ChessClock::now();
+}
+
+// The writer thread. The queue is taken in batches, and each batch is written
+// with a single flush, without holding the lock.
+void runWriter() {
+    std::deque<OutputEntry> batch;
+    std::map<unsigned int, OutputEntry> held;
+    ChessTime lastInfo, lastCurrMove;
+    std::string out;
+
+    while (true) {
+        uint64_t interval;
+        {
+            std::unique_lock<std::mutex> lock(outputQueue->mutex);
+            auto hasEntries = [] { return !outputQueue->entries.empty(); };
+            if (held.empty())
+                outputQueue->queued.wait(lock, hasEntries);
+            else {
+                outputQueue->queued.wait_until(lock,
+                    lastInfo + std::chrono::milliseconds(outputQueue->infoInterval), hasEntries);
+            }
+            std::swap(batch, outputQueue->entries);
+            interval = outputQueue->infoInterval;
+        }
+
+        for (unsigned int i = 0; i < batch.size(); i++) {
+            OutputEntry &entry = batch[i];
+            switch (entry.type) {
+                case OUTPUT_LINE:
+                    writeHeldInfo(held, out, lastInfo);
+                    appendLine(out, entry.text);
+                    break;
+                case OUTPUT_INFO: {
+                    // Lines without a PV are kept apart, after the PV lines
+                    unsigned int slot = (entry.info.bound == BOUND_NONE) ? ~0U : entry.info.multiPV;
+                    held[slot] = std::move(entry);
+                    if (getTimeElapsed(lastInfo) > interval)
+                        writeHeldInfo(held, out, lastInfo);
+                    break;
+                }
+                case OUTPUT_CURRMOVE:
+                    if (held.empty() && getTimeElapsed(lastInfo) > interval
+                     && getTimeElapsed(lastCurrMove) > CURRMOVE_INTERVAL) {
+                        appendLine(out, "info depth " + std::to_string(entry.info.depth)
+                            + " currmove " + moveToString(entry.currMove)
+                            + " currmovenumber " + std::to_string(entry.currMoveNumber)
+                            + " nodes " + std::to_string(entry.info.nodes)
+                            + " nps " + std::to_string(entry.info.nps));
+                        lastCurrMove = ChessClock::now();
+                    }
+                    break;
+                case OUTPUT_FLUSH:
+                    writeHeldInfo(held, out, lastInfo);
+                    break;
+            }
+        }
+        // The info interval may have ended while waiting
+        if (!held.empty() && getTimeElapsed(lastInfo) > interval)
+            writeHeldInfo(held, out, lastInfo);
+
+        if (!out.empty()) {
+            std::cout << out;
+            std::cout.flush();
+            out.clear();
+        }
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(outputQueue->mutex);
+            outputQueue->flushedID = batch.back().id;
+            outputQueue->flushed.notify_all();
+        }
+        batch.clear();
+    }
+}
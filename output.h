@@ -0,0 +1,71 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <sstream>
+#include <string>
+#include "common.h"
+#include "search.h"
+
+const int DEFAULT_INFO_INTERVAL = 0;
+const int MIN_INFO_INTERVAL = 0;
+const int MAX_INFO_INTERVAL = 5000;
+// currmove lines are sent at most this often, in ms
+const uint64_t CURRMOVE_INTERVAL = 1000;
+
+/*
+ * All UCI output to stdout goes through a single writer thread, so that lines
+ * from different threads never interleave and the search threads never wait
+ * on a slow pipe. Lines are written in the order they are queued, and stdout
+ * is flushed whenever the queue runs empty.
+ *
+ * Info lines are formatted by the writer. If they come faster than the info
+ * interval, only the latest line for each MultiPV slot is kept, and it is
+ * written when the interval ends or before the next plain line, such as
+ * bestmove. currmove lines that cannot be written right away are dropped.
+ */
+void writeLine(const std::string &line);
+void writeInfo(const SearchInfo &info, bool showMultiPV);
+void writeCurrMove(int depth, Move m, unsigned int moveNumber, uint64_t nodes, uint64_t nps);
+// Blocks until everything queued so far has been written and flushed
+void flushOutput();
+void setInfoInterval(int ms);
+
+/*
+ * @brief Collects one line of output with operator<<, and queues it with
+ * writeLine() when destroyed, e.g. OutputLine() << "bestmove " << move;
+ */
+class OutputLine {
+public:
+    OutputLine() {}
+    OutputLine(const OutputLine &other) = delete;
+    OutputLine& operator=(const OutputLine &other) = delete;
+    ~OutputLine() { writeLine(stream.str()); }
+
+    template <class T> OutputLine &operator<<(const T &value) {
+        stream << value;
+        return *this;
+    }
+
+private:
+    std::ostringstream stream;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "perfcounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *PERF_COUNTER_NAMES[NUM_PERF_COUNTERS] = {
+    "cycles", "instructions", "l1dmisses", "llcmisses", "branchmisses", "dtlbmisses"
+};
+
+#if defined(__linux__)
+
+// The perf_event_open type and config of each counter
+const uint32_t PERF_TYPES[NUM_PERF_COUNTERS] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+};
+const uint64_t PERF_CONFIGS[NUM_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPES[i];
+        attr.config = PERF_CONFIGS[i];
+        attr.disabled = 1;
+        // Count helper threads created during the measurement
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[i] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        values[i] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+}
+
+void PerfCounters::start() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (fds[i] < 0)
+            continue;
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void PerfCounters::stop() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        values[i] = 0;
+        if (fds[i] < 0)
+            continue;
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        // The count, the time enabled, and the time running
+        uint64_t data[3];
+        if (read(fds[i], data, sizeof(data)) != (ssize_t) sizeof(data) || data[2] == 0)
+            continue;
+        values[i] = (data[2] < data[1]) ? (uint64_t) ((double) data[0] * data[1] / data[2])
+                                        : data[0];
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        fds[i] = -1;
+        values[i] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+#endif
+
+bool PerfCounters::isAvailable(int counter) {
+    return fds[counter] >= 0;
+}
+
+bool PerfCounters::anyAvailable() {
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+        if (fds[i] >= 0)
+            return true;
+    }
+    return false;
+}
+
+uint64_t PerfCounters::get(int counter) {
+    return values[counter];
+}
@@ -0,0 +1,62 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PERFCOUNTERS_H__
+#define __PERFCOUNTERS_H__
+
+#include <cstdint>
+
+// Hardware events counted
+const int PERF_CYCLES = 0;
+const int PERF_INSTRUCTIONS = 1;
+const int PERF_L1D_MISSES = 2;
+const int PERF_LLC_MISSES = 3;
+const int PERF_BRANCH_MISSES = 4;
+const int PERF_DTLB_MISSES = 5;
+const int NUM_PERF_COUNTERS = 6;
+
+extern const char *PERF_COUNTER_NAMES[NUM_PERF_COUNTERS];
+
+/*
+ * @brief Hardware performance counters for user space code in the calling
+ * thread and the threads it creates afterwards, read with perf_event_open on
+ * Linux. Events that cannot be opened, for example in a container or on other
+ * systems, are marked unavailable and read as 0. If the events have to share the hardware counters, the counts are scaled
+ * by the fraction of the time each was counted.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    PerfCounters(const PerfCounters &other) = delete;
+    PerfCounters& operator=(const PerfCounters &other) = delete;
+    ~PerfCounters();
+
+    bool isAvailable(int counter);
+    bool anyAvailable();
+    // Resets and starts all counters
+    void start();
+    // Stops the counters and reads them
+    void stop();
+    uint64_t get(int counter);
+
+private:
+    int fds[NUM_PERF_COUNTERS];
+    uint64_t values[NUM_PERF_COUNTERS];
+};
+
+#endif
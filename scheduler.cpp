@@ -0,0 +1,140 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "scheduler.h"
+
+SearchScheduler::SearchScheduler(int numThreads, uint64_t slice) {
+    sliceNodes = slice;
+    nextJobID = 0;
+    currentPass = 0;
+    shuttingDown = false;
+    for (int i = 0; i < numThreads; i++)
+        threads.push_back(std::thread(&SearchScheduler::run, this));
+}
+
+SearchScheduler::~SearchScheduler() {
+    {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        for (std::list<Job *>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+            (*it)->cancelled = true;
+            (*it)->stop = true;
+        }
+        jobDone.wait(lock, [this] { return jobs.empty(); });
+        shuttingDown = true;
+        jobReady.notify_all();
+    }
+    for (unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+int SearchScheduler::submit(int threadID, Board &b, TwoFoldStack &history,
+        TimeManagement *timeParams, ChessTime startTime, int priority,
+        InfoCallback info, BestMoveCallback bestMove, void *data) {
+    Job *job = new Job();
+    job->priority = std::max(MIN_JOB_PRIORITY, std::min(MAX_JOB_PRIORITY, priority));
+    job->running = false;
+    job->cancelled = false;
+    job->stop = false;
+    job->info = info;
+    job->bestMove = bestMove;
+    job->data = data;
+    startWorkerSearch(&job->ws, threadID, b, history, timeParams, startTime, &job->stop);
+
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    job->id = nextJobID++;
+    job->pass = currentPass;
+    jobs.push_back(job);
+    jobReady.notify_one();
+    return job->id;
+}
+
+void SearchScheduler::cancel(int jobID) {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    Job *job = findJob(jobID);
+    if (job != nullptr) {
+        job->cancelled = true;
+        job->stop = true;
+    }
+}
+
+void SearchScheduler::wait(int jobID) {
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    jobDone.wait(lock, [this, jobID] { return findJob(jobID) == nullptr; });
+}
+
+// Must be called with jobsMutex held
+SearchScheduler::Job *SearchScheduler::findJob(int jobID) {
+    for (std::list<Job *>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        if ((*it)->id == jobID)
+            return *it;
+    }
+    return nullptr;
+}
+
+// Returns the runnable job with the lowest pass, or nullptr if all jobs are
+// running. Cancelled jobs go first, since they only need to report their
+// result. Must be called with jobsMutex held.
+SearchScheduler::Job *SearchScheduler::nextJob() {
+    Job *best = nullptr;
+    for (std::list<Job *>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        Job *job = *it;
+        if (job->running)
+            continue;
+        if (job->cancelled)
+            return job;
+        if (best == nullptr || job->pass < best->pass)
+            best = job;
+    }
+    return best;
+}
+
+void SearchScheduler::run() {
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    while (true) {
+        Job *job = nullptr;
+        while (!shuttingDown && (job = nextJob()) == nullptr)
+            jobReady.wait(lock);
+        if (job == nullptr)
+            return;
+
+        job->running = true;
+        currentPass = std::max(currentPass, job->pass);
+        uint64_t nodesBefore = job->ws.nodes;
+        lock.unlock();
+
+        bool finished = continueWorkerSearch(&job->ws, sliceNodes, job->info, job->data);
+        if (finished)
+            job->bestMove(job->ws.bestMove, job->ws.ponder, job->data);
+
+        lock.lock();
+        if (finished) {
+            jobs.remove(job);
+            delete job;
+            jobDone.notify_all();
+            continue;
+        }
+        job->pass += (job->ws.nodes - nodesBefore) / job->priority + 1;
+        job->running = false;
+        // A slice that ended just as the job was cancelled may have cleared
+        // the stop signal
+        if (job->cancelled)
+            job->stop = true;
+        jobReady.notify_one();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "common.h"
+#include "search.h"
+#include "timeman.h"
+
+const int MIN_JOB_PRIORITY = 1;
+const int DEFAULT_JOB_PRIORITY = 10;
+const int MAX_JOB_PRIORITY = 100;
+// Nodes searched by a job before another job gets a turn
+const uint64_t DEFAULT_SLICE_NODES = 250000;
+
+/*
+ * @brief Runs many worker searches on a fixed number of threads by splitting
+ * them into slices. Each job runs on a worker reserved by the caller, whose
+ * memory keeps the job's history tables while it is suspended.
+ *
+ * Jobs are picked by stride scheduling: each job's pass grows by the nodes it
+ * searches divided by its priority, and the runnable job with the lowest pass
+ * runs next. Jobs therefore share the threads in proportion to priority, and
+ * no job starves.
+ */
+class SearchScheduler {
+public:
+    SearchScheduler(int threads, uint64_t sliceNodes);
+    SearchScheduler(const SearchScheduler &other) = delete;
+    SearchScheduler& operator=(const SearchScheduler &other) = delete;
+    // Cancels all remaining jobs and waits for them to report
+    ~SearchScheduler();
+
+    // Queues a search of a position with the limits in timeParams, and returns
+    // the job ID. The callbacks are called from the scheduler's threads, and
+    // the worker must not be used elsewhere until the job has finished.
+    int submit(int threadID, Board &b, TwoFoldStack &history, TimeManagement *timeParams,
+        ChessTime startTime, int priority, InfoCallback info, BestMoveCallback bestMove,
+        void *data);
+    // Ends a job early. It still reports its best move.
+    void cancel(int jobID);
+    // Blocks until a job has reported its best move
+    void wait(int jobID);
+
+private:
+    struct Job {
+        int id;
+        int priority;
+        uint64_t pass;
+        bool running;
+        bool cancelled;
+        std::atomic<bool> stop;
+        WorkerSearch ws;
+        InfoCallback info;
+        BestMoveCallback bestMove;
+        void *data;
+    };
+
+    uint64_t sliceNodes;
+    std::vector<std::thread> threads;
+    std::list<Job *> jobs;
+    int nextJobID;
+    // The pass of the last job picked, at which new jobs start
+    uint64_t currentPass;
+    bool shuttingDown;
+    std::mutex jobsMutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+
+    Job *findJob(int jobID);
+    Job *nextJob();
+    void run();
+};
+
+#endif
@@ -19,53 +19,30 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <sstream>
 #include <thread>
 #include <vector>
+#include "book.h"
 #include "eval.h"
 #include "evalhash.h"
 #include "hash.h"
 #include "search.h"
 #include "moveorder.h"
+#include "output.h"
 #include "searchparams.h"
+#include "searchtrace.h"
 #include "timeman.h"
 #include "uci.h"
 #include "syzygy/tbprobe.h"
 
-using std::cout;
 using std::cerr;
 using std::endl;
 
 
-// Records useful statistics which are printed to std::err at the end of each search
-struct SearchStatistics {
-    uint64_t nodes;
-    uint64_t tbhits;
-    uint64_t hashProbes, hashHits, hashScoreCuts;
-    uint64_t hashMoveAttempts, hashMoveCuts;
-    uint64_t failHighs, firstFailHighs;
-    uint64_t qsNodes;
-    uint64_t qsFailHighs, qsFirstFailHighs;
-    uint64_t evalCacheProbes, evalCacheHits;
-
-    SearchStatistics() {
-        reset();
-    }
-
-    void reset() {
-        nodes = 0;
-        tbhits = 0;
-        hashProbes = hashHits = hashScoreCuts = 0;
-        hashMoveAttempts = hashMoveCuts = 0;
-        failHighs = firstFailHighs = 0;
-        qsNodes = 0;
-        qsFailHighs = qsFirstFailHighs = 0;
-        evalCacheProbes = evalCacheHits = 0;
-    }
-};
-
 // Records the PV found by the search.
 struct SearchPV {
     int pvLength;
@@ -76,21 +53,161 @@ struct SearchPV {
     }
 };
 
+// How an iteration of the main search went, for the iteration report
+struct IterationReport {
+    int depth;
+    // False if the iteration was stopped before the first PV was resolved
+    bool complete;
+    // Nodes and time of this iteration, and of the whole search so far
+    uint64_t nodes, time;
+    uint64_t totalNodes, totalTime;
+    // Nodes and time of the previous iteration, or 0 if there was none
+    uint64_t prevNodes, prevTime;
+    int score;
+    Move bestMove;
+    // Whether the best move differs from that of the previous iteration, and
+    // how many times it changed during this iteration. The first iteration
+    // has no previous best move, so it has no changes.
+    bool bestMoveChanged;
+    int bestMoveChanges;
+    int failLows, failHighs;
+    // The width of each aspiration window searched, or 0 for a full window
+    std::vector<int> windows;
+    // The iteration each thread was searching. Helper threads search deeper
+    // than the main thread, and are stopped at the end of each of its
+    // iterations.
+    std::vector<int> threadDepths;
+};
+
+// Flight recorder events
+const int FLIGHT_SEARCH_START = 0;
+const int FLIGHT_ITERATION_START = 1;
+const int FLIGHT_FAIL_LOW = 2;
+const int FLIGHT_FAIL_HIGH = 3;
+const int FLIGHT_ITERATION_END = 4;
+const int FLIGHT_TIME_LIMIT = 5;
+const int FLIGHT_NODE_LIMIT = 6;
+const int FLIGHT_STOP_COMMAND = 7;
+const int FLIGHT_SEARCH_END = 8;
+const char *FLIGHT_EVENT_NAMES[9] = {
+    "search start", "iteration start", "fail low", "fail high", "iteration end",
+    "time limit", "node limit", "stop command", "search end"
+};
+const int FLIGHT_RECORDER_EVENTS = 64;
+
+// A search event kept by the flight recorder
+struct FlightEvent {
+    int type;
+    // Time since the search started, and the thread's nodes at that time
+    uint64_t time;
+    uint64_t nodes;
+    int depth;
+    int score;
+    Move move;
+};
+
+/*
+ * @brief Keeps the last FLIGHT_RECORDER_EVENTS events of one thread. Events
+ * are only recorded at root iterations and when the search stops, so the
+ * recorder is always on. A dump may read it while its thread is writing, in
+ * which case the newest event can be torn.
+ */
+struct FlightRecorder {
+    FlightEvent events[FLIGHT_RECORDER_EVENTS];
+    std::atomic<uint64_t> count;
+
+    FlightRecorder() : count(0) {}
+
+    // Only one thread may record events
+    void record(int type, uint64_t time, uint64_t nodes, int depth, int score, Move move) {
+        uint64_t n = count.load(std::memory_order_relaxed);
+        FlightEvent &e = events[n % FLIGHT_RECORDER_EVENTS];
+        e.type = type;
+        e.time = time;
+        e.nodes = nodes;
+        e.depth = depth;
+        e.score = score;
+        e.move = move;
+        count.store(n + 1, std::memory_order_release);
+    }
+};
+
+// Limits for a search run by a worker, which does not use the global time
+// management. A limit of 0 means no limit.
+struct WorkerLimits {
+    ChessTime startTime;
+    uint64_t timeLimit;
+    uint64_t nodeLimit;
+};
+
 // Stores all of the per-thread search structs.
 struct ThreadMemory {
     SearchParameters searchParams;
     SearchStatistics searchStats;
     SearchStackInfo ssInfo[129];
     TwoFoldStack twoFoldPositions;
+    // The eval cache used by this thread: either the shared table or this
+    // thread's private table
+    EvalHash *evalCache;
+    EvalHash *privateEvalCache;
+    // The transposition table used by this thread. Only workers may have a
+    // private table.
+    Hash *transTable;
+    Hash *privateTransTable;
+    // The stop signal checked by this thread: the global one for the main
+    // search, or the one given to workerSearch() for a worker
+    std::atomic<bool> *stop;
+    // The iteration this thread is searching, or 0 before its first one
+    std::atomic<int> searchDepth;
+    bool isWorker;
+    WorkerLimits workerLimits;
+    FlightRecorder flightRecorder;
+#if defined(TRACE)
+    TraceBuffer trace;
+#endif
 
     ThreadMemory() {
-        for (int i = 0; i < 129; i++)
+        // The root and ply 1 have no previous moves for the continuation
+        // histories, so their pointers must start out null
+        for (int i = 0; i < 129; i++) {
             ssInfo[i].ply = i;
+            ssInfo[i].counterMoveHistory = nullptr;
+            ssInfo[i].followupMoveHistory = nullptr;
+        }
+        evalCache = nullptr;
+        privateEvalCache = nullptr;
+        transTable = nullptr;
+        privateTransTable = nullptr;
+        stop = nullptr;
+        searchDepth = 0;
+        isWorker = false;
     }
 
-    ~ThreadMemory() = default;
+    ~ThreadMemory() {
+        delete privateEvalCache;
+        delete privateTransTable;
+    }
 };
 
+// Fill in the record of the node being traced, if there is one
+#if defined(TRACE)
+#define TRACE_NOTE(threadID, field, value) \
+    do { \
+        TraceRecord *traceNode = threadMemoryArray[threadID]->trace.current; \
+        if (traceNode != nullptr) \
+            traceNode->field = (value); \
+    } while (0)
+#define TRACE_COUNT(threadID, field) \
+    do { \
+        TraceRecord *traceNode = threadMemoryArray[threadID]->trace.current; \
+        if (traceNode != nullptr) \
+            traceNode->field++; \
+    } while (0)
+#else
+#define TRACE_NOTE(threadID, field, value)
+#define TRACE_COUNT(threadID, field)
+#endif
+
 //-------------------------------Search Constants-------------------------------
 // Lazy SMP depths
 const int SMP_DEPTHS[16] = {
@@ -136,12 +253,22 @@ const unsigned int LMP_MOVE_COUNTS[2][13] = {
 
 //-----------------------------Global variables---------------------------------
 static Hash transpositionTable(DEFAULT_HASH_SIZE);
-static EvalHash evalCache(DEFAULT_HASH_SIZE);
+static EvalHash sharedEvalCache(DEFAULT_HASH_SIZE);
 static std::vector<ThreadMemory *> threadMemoryArray;
+// Held while threadMemoryArray or the transposition table is resized, so that
+// dumpSearchState() and recordStopCommand() can read them from other threads
+static std::mutex resizeMutex;
+
+// Eval cache configuration. In per-thread mode, the cache size is divided
+// evenly between the threads' private tables.
+static uint64_t evalCacheSize = DEFAULT_HASH_SIZE;
+static bool evalCachePerThread = false;
 
 // Variables for time management
 ChessTime startTime;
 uint64_t timeLimit;
+// Node limit for go nodes, or 0 if there is none
+uint64_t nodeLimit;
 
 // Used to break out of the search thread if the stop command is given
 std::atomic<bool> isStop(true);
@@ -155,10 +282,36 @@ std::mutex threadsRunningMutex;
 int dummyBestIndex[MAX_THREADS-1];
 int dummyBestScore[MAX_THREADS-1];
 
+// The search being run, for dumpSearchState()
+static std::mutex rootMutex;
+static std::string rootFEN;
+static std::atomic<int> rootDepthSearched(0);
+// Stop commands, only recorded by the input thread
+static FlightRecorder controlRecorder;
+
 // Values for UCI options
 unsigned int multiPV;
 int numThreads;
-bool isPonderSearch = false;
+std::atomic<bool> isPonderSearch(false);
+bool useIIR = false;
+bool useHashEval = true;
+bool useOwnBook = false;
+bool bookBestMove = false;
+
+// Per-iteration reports, printed as info strings and/or appended to a file as
+// JSON lines
+static bool iterationReport = false;
+static std::ofstream iterationReportFile;
+// Numbers the searches in the report file
+static uint64_t reportedSearches = 0;
+
+// Polyglot opening book, if one has been loaded
+Book openingBook;
+
+// Callbacks for embedding the engine, see setSearchCallbacks()
+static InfoCallback infoCallback = nullptr;
+static BestMoveCallback bestMoveCallback = nullptr;
+static void *callbackData = nullptr;
 
 // Accessible from tbcore.c
 int TBlargest = 0;
@@ -175,19 +328,33 @@ void getBestMoveAtDepthHelper(Board *b, MoveList *legalMoves, int depth, int alp
 int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine);
 int quiescence(Board &b, int plies, int alpha, int beta, int threadID);
 int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID);
+// The searches of a single node, called through the functions above, which
+// record the node in trace builds
+int searchPVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine);
+int searchQuiescence(Board &b, int plies, int alpha, int beta, int threadID);
+int searchCheckQuiescence(Board &b, int plies, int alpha, int beta, int threadID);
 
 // Search helpers
 int scoreMate(bool isInCheck, int plies);
 int adjustHashScore(int score, int plies);
 
 // Other utility functions
-Move nextMove(MoveList &moves, ScoreList &scores, unsigned int index);
+ExtMove nextMove(ExtMoveList &moves, unsigned int index);
 uint64_t getTBHits();
 void changePV(Move best, SearchPV *parent, SearchPV *child);
 std::string retrievePV(SearchPV *pvLine);
+SearchInfo getSearchInfo(int depth, unsigned int multiPVNum, int bound, int score,
+    bool tbProbeSuccess, int tbScore, uint64_t timeSoFar, SearchPV *pvLine);
+void setInfoScore(SearchInfo &info, int bound, int score);
+void reportInfo(const SearchInfo &info);
+void reportBestMove(Move bestMove, Move ponder);
+void reportIteration(Board *b, const IterationReport &report);
 int getSelectiveDepth();
 double getPercentage(uint64_t numerator, uint64_t denominator);
 void printStatistics();
+void updateEvalCaches();
+void checkWorkerLimits(ThreadMemory *tm);
+void recordEvent(int threadID, int type, int depth, int score, Move move);
 
 
 // Finds a best move for a position according to the given search parameters.
@@ -195,6 +362,7 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
     for (int i = 0; i < numThreads; i++) {
         threadMemoryArray[i]->searchParams.reset();
         threadMemoryArray[i]->searchStats.reset();
+        threadMemoryArray[i]->searchDepth = 0;
         threadMemoryArray[i]->searchParams.rootMoveNumber = (uint8_t) (b->getMoveNumber());
         threadMemoryArray[i]->searchParams.selectiveDepth = 0;
     }
@@ -207,18 +375,40 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
     if (legalMoves.size() <= 0) {
         stopSignal = true;
         isStop = true;
-        cout << "bestmove none" << endl;
+        reportBestMove(NULL_MOVE, NULL_MOVE);
         return;
     }
 
+    // Play instantly from the opening book if we can. Infinite, fixed depth,
+    // and ponder searches must wait for a stop command, so they always search.
+    if (useOwnBook && !isPonderSearch && movesToSearch->size() == 0
+     && (timeParams->searchMode == TIME || timeParams->searchMode == MOVETIME)) {
+        Move bookMove = openingBook.probe(*b, bookBestMove);
+        if (bookMove != NULL_MOVE) {
+            stopSignal = true;
+            isStop = true;
+            if (infoCallback == nullptr)
+                writeLine("info string book move");
+            reportBestMove(bookMove, NULL_MOVE);
+            return;
+        }
+    }
+
     Move bestMove = legalMoves.get(0);
 
     // Set up timing
     timeLimit = (timeParams->searchMode == TIME) ? timeParams->maxAllotment
                                                  : (timeParams->searchMode == MOVETIME) ? timeParams->allotment
                                                                                         : MAX_TIME;
+    nodeLimit = (timeParams->searchMode == NODES) ? timeParams->allotment : 0;
     startTime = ChessClock::now();
     uint64_t timeSoFar = getTimeElapsed(startTime);
+    {
+        std::lock_guard<std::mutex> lock(rootMutex);
+        rootFEN = boardToFEN(*b);
+    }
+    rootDepthSearched = 0;
+    recordEvent(0, FLIGHT_SEARCH_START, 0, 0, NULL_MOVE);
 
     // Special case if there is only one legal move: use less search time,
     // only to get a rough PV/score
@@ -276,11 +466,22 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
     int rootDepth = 1;
     Move prevBest = NULL_MOVE;
     int pvStreak = 0;
+    uint64_t prevIterationNodes = 0, prevIterationTime = 0;
+    reportedSearches++;
 
     // Iterative deepening loop
     do {
         // For recording the PV
         SearchPV pvLine;
+        IterationReport report;
+        report.depth = rootDepth;
+        report.failLows = report.failHighs = 0;
+        report.bestMoveChanges = 0;
+        uint64_t iterationStartNodes = getNodes();
+        uint64_t iterationStartTime = getTimeElapsed(startTime);
+        rootDepthSearched = rootDepth;
+        threadMemoryArray[0]->searchDepth = rootDepth;
+        recordEvent(0, FLIGHT_ITERATION_START, rootDepth, 0, NULL_MOVE);
 
         // Handle multi PV (if multiPV = 1 then the loop is only run once)
         for (unsigned int multiPVNum = 1;
@@ -309,6 +510,10 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
                     threadMemoryArray[i]->searchParams.reset();
                 pvLine.pvLength = 0;
                 threadsRunning = numThreads-1;
+                if (multiPVNum == 1) {
+                    bool isFullWindow = (aspAlpha == -MATE_SCORE && aspBeta == MATE_SCORE);
+                    report.windows.push_back(isFullWindow ? 0 : aspBeta - aspAlpha);
+                }
 
                 // Get the index of the best move
                 // If depth >= 7 create threads for SMP
@@ -346,9 +551,6 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
                 }
 
                 timeSoFar = getTimeElapsed(startTime);
-                // Calculate values for printing
-                uint64_t nps = 1000 * getNodes() / timeSoFar;
-                std::string pvStr = retrievePV(&pvLine);
                 if (pvLine.pvLength > 1)
                     ponder = pvLine.pv[1];
                 else if (bestMoveIndex != 0)
@@ -357,17 +559,12 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
                 // Handle fail highs and fail lows
                 // Fail low: no best move found
                 if (bestMoveIndex == -1 && !isStop) {
-                    cout << "info depth " << rootDepth;
-                    cout << " seldepth " << getSelectiveDepth();
-                    cout << " score";
-                    cout << " cp " << (tbProbeSuccess ? (tbScore == 0 ? 0 : (bestScore/10 + tbScore)) : bestScore) * 100 / PIECE_VALUES[EG][PAWNS] << " upperbound";
-
-                    cout << " time " << timeSoFar
-                         << " nodes " << getNodes() << " nps " << nps
-                         << " tbhits " << getTBHits()
-                         << " hashfull " << transpositionTable.estimateHashfull(threadMemoryArray[0]->searchParams.rootMoveNumber)
-                         << " pv " << pvStr << endl;
+                    reportInfo(getSearchInfo(rootDepth, multiPVNum, BOUND_UPPER, bestScore,
+                        tbProbeSuccess, tbScore, timeSoFar, &pvLine));
 
+                    if (multiPVNum == 1)
+                        report.failLows++;
+                    recordEvent(0, FLIGHT_FAIL_LOW, rootDepth, bestScore, NULL_MOVE);
                     aspAlpha = bestScore - deltaAlpha;
                     deltaAlpha *= 2;
                     if (aspAlpha < -NEAR_MATE_SCORE)
@@ -375,17 +572,12 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
                 }
                 // Fail high: best score is at least beta
                 else if (bestScore >= aspBeta) {
-                    cout << "info depth " << rootDepth;
-                    cout << " seldepth " << getSelectiveDepth();
-                    cout << " score";
-                    cout << " cp " << (tbProbeSuccess ? (tbScore == 0 ? 0 : (bestScore/10 + tbScore)) : bestScore) * 100 / PIECE_VALUES[EG][PAWNS] << " lowerbound";
-
-                    cout << " time " << timeSoFar
-                         << " nodes " << getNodes() << " nps " << nps
-                         << " tbhits " << getTBHits()
-                         << " hashfull " << transpositionTable.estimateHashfull(threadMemoryArray[0]->searchParams.rootMoveNumber)
-                         << " pv " << pvStr << endl;
+                    reportInfo(getSearchInfo(rootDepth, multiPVNum, BOUND_LOWER, bestScore,
+                        tbProbeSuccess, tbScore, timeSoFar, &pvLine));
 
+                    if (multiPVNum == 1)
+                        report.failHighs++;
+                    recordEvent(0, FLIGHT_FAIL_HIGH, rootDepth, bestScore, legalMoves.get(bestMoveIndex));
                     aspBeta = bestScore + deltaBeta;
                     deltaBeta *= 2;
                     if (aspBeta > NEAR_MATE_SCORE)
@@ -400,6 +592,8 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
                         break;
 
                     legalMoves.swap(multiPVNum-1, bestMoveIndex);
+                    if (prevBest != NULL_MOVE && legalMoves.get(0) != bestMove)
+                        report.bestMoveChanges++;
                     bestMove = legalMoves.get(0);
                 }
                 // If no fails, we are done
@@ -407,55 +601,49 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
             }
             // End aspiration loop
 
-            // Calculate values for printing
             timeSoFar = getTimeElapsed(startTime);
-            uint64_t nps = 1000 * getNodes() / timeSoFar;
-            std::string pvStr = retrievePV(&pvLine);
 
             // If we broke out before getting any new results, end the search
             if (bestMoveIndex == -1) {
-                cout << "info depth " << rootDepth-1;
-                cout << " seldepth " << getSelectiveDepth();
-                cout << " time " << timeSoFar
-                     << " nodes " << getNodes() << " nps " << nps
-                     << " tbhits " << getTBHits()
-                     << " hashfull " << transpositionTable.estimateHashfull(threadMemoryArray[0]->searchParams.rootMoveNumber)
-                     << endl;
+                reportInfo(getSearchInfo(rootDepth-1, multiPVNum, BOUND_NONE, 0,
+                    tbProbeSuccess, tbScore, timeSoFar, nullptr));
                 break;
             }
 
             // Swap the PV to be searched first next iteration
             legalMoves.swap(multiPVNum-1, bestMoveIndex);
+            if (prevBest != NULL_MOVE && legalMoves.get(0) != bestMove)
+                report.bestMoveChanges++;
             bestMove = legalMoves.get(0);
 
             // Output info using UCI protocol
-            cout << "info depth " << rootDepth;
-            cout << " seldepth " << getSelectiveDepth();
-            if (multiPV > 1)
-                cout << " multipv " << multiPVNum;
-            cout << " score";
-
-            // Print score in mate or centipawns
-            if (bestScore >= MAX_PLY_MATE_SCORE)
-                // If it is our mate, it takes plies / 2 + 1 moves to mate since
-                // our move ends the game
-                cout << " mate " << (MATE_SCORE - bestScore) / 2 + 1;
-            else if (bestScore <= -MAX_PLY_MATE_SCORE)
-                // If we are being mated, it takes plies / 2 moves since our
-                // opponent's move ends the game
-                cout << " mate " << (-MATE_SCORE - bestScore) / 2;
-            else
-                // Scale score into centipawns using our internal pawn value
-                cout << " cp " << (tbProbeSuccess ? (tbScore == 0 ? 0 : (bestScore/10 + tbScore)) : bestScore) * 100 / PIECE_VALUES[EG][PAWNS];
-
-            cout << " time " << timeSoFar
-                 << " nodes " << getNodes() << " nps " << nps
-                 << " tbhits " << getTBHits()
-                 << " hashfull " << transpositionTable.estimateHashfull(threadMemoryArray[0]->searchParams.rootMoveNumber)
-                 << " pv " << pvStr << endl;
+            reportInfo(getSearchInfo(rootDepth, multiPVNum, BOUND_EXACT, bestScore,
+                tbProbeSuccess, tbScore, timeSoFar, &pvLine));
+            if (multiPVNum == 1) {
+                threadMemoryArray[0]->searchStats.completedDepth = rootDepth;
+                recordEvent(0, FLIGHT_ITERATION_END, rootDepth, bestScore, bestMove);
+            }
         }
         // End multiPV loop
 
+        if (iterationReport || iterationReportFile.is_open()) {
+            report.complete = (threadMemoryArray[0]->searchStats.completedDepth == rootDepth);
+            report.totalNodes = getNodes();
+            report.totalTime = getTimeElapsed(startTime);
+            report.nodes = report.totalNodes - iterationStartNodes;
+            report.time = report.totalTime - iterationStartTime;
+            report.prevNodes = prevIterationNodes;
+            report.prevTime = prevIterationTime;
+            report.score = bestScore;
+            report.bestMove = bestMove;
+            report.bestMoveChanged = (prevBest != NULL_MOVE && bestMove != prevBest);
+            for (int i = 0; i < numThreads; i++)
+                report.threadDepths.push_back(threadMemoryArray[i]->searchDepth);
+            reportIteration(b, report);
+            prevIterationNodes = report.nodes;
+            prevIterationTime = report.time;
+        }
+
         if (bestMove == prevBest) {
             pvStreak++;
         }
@@ -491,21 +679,22 @@ void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch)
         && ((((timeParams->searchMode == TIME && timeSoFar < (uint64_t) timeParams->allotment * TIME_FACTOR)
             || isPonderSearch) && rootDepth <= MAX_DEPTH)
          || (timeParams->searchMode == MOVETIME && timeSoFar < (uint64_t) timeParams->allotment && rootDepth <= MAX_DEPTH)
+         || (timeParams->searchMode == NODES && rootDepth <= MAX_DEPTH)
          || (timeParams->searchMode == DEPTH && rootDepth <= timeParams->allotment)));
 
     // When pondering, we must continue "searching" until given a stop or ponderhit command.
     while (isPonderSearch && !isStop)
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
 
-    printStatistics();
+    // Statistics are only printed for the UCI interface
+    if (bestMoveCallback == nullptr)
+        printStatistics();
 
     // Output best move to UCI interface
     stopSignal = true;
     isStop = true;
-    if (ponder != NULL_MOVE)
-        cout << "bestmove " << moveToString(bestMove) << " ponder " << moveToString(ponder) << endl;
-    else
-        cout << "bestmove " << moveToString(bestMove) << endl;
+    recordEvent(0, FLIGHT_SEARCH_END, threadMemoryArray[0]->searchStats.completedDepth, bestScore, bestMove);
+    reportBestMove(bestMove, ponder);
     return;
 }
 
@@ -513,8 +702,16 @@ void getBestMoveAtDepthHelper(Board *b, MoveList *legalMoves, int depth, int alp
         int beta, int *bestMoveIndex, int *bestScore, unsigned int startMove,
         int threadID, SearchPV *pvLine) {
     while (depth <= MAX_DEPTH && !stopSignal) {
+        threadMemoryArray[threadID]->searchDepth = depth;
+        recordEvent(threadID, FLIGHT_ITERATION_START, depth, 0, NULL_MOVE);
         getBestMoveAtDepth(b, legalMoves, depth, alpha, beta,
                            bestMoveIndex, bestScore, startMove, threadID, pvLine);
+        SearchStatistics &searchStats = threadMemoryArray[threadID]->searchStats;
+        if (!stopSignal) {
+            searchStats.completedDepth = std::max(searchStats.completedDepth, depth);
+            recordEvent(threadID, FLIGHT_ITERATION_END, depth, *bestScore,
+                (*bestMoveIndex >= 0) ? legalMoves->get(*bestMoveIndex) : NULL_MOVE);
+        }
         depth++;
     }
 
@@ -539,6 +736,11 @@ void getBestMoveAtDepth(Board *b, MoveList *legalMoves, int depth, int alpha,
     *bestScore = -INFTY;
     SearchStackInfo *ssi = &(threadMemoryArray[threadID]->ssInfo[0]);
 
+#if defined(TRACE)
+    if (isTracing())
+        threadMemoryArray[threadID]->trace.markIteration(depth, threadID);
+#endif
+
     // Push current position to two fold stack
     threadMemoryArray[threadID]->twoFoldPositions.push(b->getZobristKey());
 
@@ -552,9 +754,8 @@ void getBestMoveAtDepth(Board *b, MoveList *legalMoves, int depth, int alpha,
         // search have elapsed to avoid clutter
         uint64_t timeSoFar = getTimeElapsed(startTime);
         uint64_t nps = 1000 * getNodes() / timeSoFar;
-        if (threadID == 0 && timeSoFar > 5 * ONE_SECOND)
-            cout << "info depth " << depth << " currmove " << moveToString(legalMoves->get(i))
-                 << " currmovenumber " << i+1 << " nodes " << getNodes() << " nps " << nps << endl;
+        if (threadID == 0 && infoCallback == nullptr && timeSoFar > 5 * ONE_SECOND)
+            writeCurrMove(depth, legalMoves->get(i), i+1, getNodes(), nps);
 
         Board copy = b->staticCopy();
         copy.doMove(legalMoves->get(i), color);
@@ -578,7 +779,7 @@ void getBestMoveAtDepth(Board *b, MoveList *legalMoves, int depth, int alpha,
 
         // Stop condition. If stopping, return search results from incomplete
         // search, if any.
-        if (stopSignal.load(std::memory_order_seq_cst))
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_seq_cst))
             break;
 
         if (score > *bestScore) {
@@ -606,7 +807,7 @@ void getBestMoveAtDepth(Board *b, MoveList *legalMoves, int depth, int alpha,
 //------------------------------Search functions--------------------------------
 //------------------------------------------------------------------------------
 // The standard implementation of a fail-soft PVS search.
-int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine) {
+int searchPVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine) {
     SearchParameters *searchParams = &(threadMemoryArray[threadID]->searchParams);
     SearchStatistics *searchStats = &(threadMemoryArray[threadID]->searchStats);
     // Reset the PV line
@@ -622,25 +823,44 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     }
 
     // Draw check
-    if (b.isDraw())
+    if (b.isDraw()) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
         return 0;
-    if (threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey()))
+    }
+    if (threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey(), b.getFiftyMoveCounter())) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
         return 0;
+    }
+
+    // Upcoming repetition detection
+    // If a single reversible move reaches an earlier position in the search
+    // tree, we can claim at least a draw score here
+    if (alpha < 0 && threadMemoryArray[threadID]->twoFoldPositions.findUpcoming(b, ssi->ply)) {
+        alpha = 0;
+        if (alpha >= beta) {
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
+            return alpha;
+        }
+    }
 
 
     // Mate distance pruning
     int matingScore = MATE_SCORE - ssi->ply;
     if (matingScore < beta) {
         beta = matingScore;
-        if (alpha >= matingScore)
+        if (alpha >= matingScore) {
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_MATE_DISTANCE);
             return alpha;
+        }
     }
 
     int matedScore = -MATE_SCORE + ssi->ply;
     if (matedScore > alpha) {
         alpha = matedScore;
-        if (beta <= matedScore)
+        if (beta <= matedScore) {
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_MATE_DISTANCE);
             return beta;
+        }
     }
 
 
@@ -656,14 +876,17 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     // other than -INFTY
     Move hashed = NULL_MOVE;
     int hashScore = -INFTY;
+    int hashEval = INFTY;
     int hashDepth = 0;
     uint8_t nodeType = NO_NODE_INFO;
     searchStats->hashProbes++;
 
-    uint64_t hashEntry = transpositionTable.get(b);
+    uint64_t hashEntry = threadMemoryArray[threadID]->transTable->get(b);
     if (hashEntry != 0) {
         searchStats->hashHits++;
+        TRACE_NOTE(threadID, tt, TRACE_TT_HIT);
         hashScore = getHashScore(hashEntry);
+        hashEval = getHashEval(hashEntry);
         nodeType = getHashNodeType(hashEntry);
         hashDepth = getHashDepth(hashEntry);
         hashed = getHashMove(hashEntry);
@@ -689,6 +912,8 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
              || (nodeType == CUT_NODE && hashScore >= beta)
              || (nodeType == PV_NODE)) {
                 searchStats->hashScoreCuts++;
+                TRACE_NOTE(threadID, tt, TRACE_TT_CUT);
+                TRACE_NOTE(threadID, exit, TRACE_EXIT_HASH);
                 return hashScore;
             }
         }
@@ -715,10 +940,11 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
             // Hash the TB result
             int tbDepth = std::min(depth+4, MAX_DEPTH);
             uint64_t hashData = packHashData(tbDepth, NULL_MOVE,
-                adjustHashScore(tbScore, ssi->ply), PV_NODE,
+                adjustHashScore(tbScore, ssi->ply), INFTY, PV_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, tbDepth, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, tbDepth, searchParams->rootMoveNumber);
 
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_TABLEBASE);
             return tbScore;
         }
     }
@@ -731,10 +957,15 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     // A static evaluation, used to make numerous pruning decisions
     int staticEval = INFTY;
     ssi->staticEval = INFTY;
-    if (!isInCheck) {
+    if (!isInCheck && useHashEval && hashEval != INFTY) {
+        // The TT entry already has the static eval for this position
+        searchStats->hashEvalHits++;
+        ssi->staticEval = staticEval = hashEval;
+    }
+    else if (!isInCheck) {
         searchStats->evalCacheProbes++;
         // Probe the eval cache for a saved evaluation
-        int ehe = evalCache.get(b);
+        int ehe = threadMemoryArray[threadID]->evalCache->get(b);
         if (ehe != 0) {
             searchStats->evalCacheHits++;
             ssi->staticEval = staticEval = ehe - EVAL_HASH_OFFSET;
@@ -743,9 +974,12 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
             Eval e;
             ssi->staticEval = staticEval = (color == WHITE) ? e.evaluate(b)
                                                             : -e.evaluate(b);
-            evalCache.add(b, staticEval);
+            threadMemoryArray[threadID]->evalCache->add(b, staticEval);
         }
     }
+    TRACE_NOTE(threadID, staticEval, staticEval);
+    if (isInCheck)
+        TRACE_NOTE(threadID, flags, TRACE_IN_CHECK);
 
     // Use the TT score as a better "static" eval, if available.
     if (hashScore != -INFTY) {
@@ -767,9 +1001,14 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     // adapted to low depths, also called static null move pruning)
     if (!isPVNode && !isInCheck
      && depth <= 6
-     && staticEval - REVERSE_FUTILITY_MARGIN[depth] >= beta
-     && b.getNonPawnMaterial(color))
-        return staticEval;
+     && b.getNonPawnMaterial(color)) {
+        searchStats->reverseFutilityTries++;
+        if (staticEval - REVERSE_FUTILITY_MARGIN[depth] >= beta) {
+            searchStats->reverseFutilityPrunes++;
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_REVERSE_FUTILITY);
+            return staticEval;
+        }
+    }
 
 
     // Razoring
@@ -780,15 +1019,22 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     if (!isPVNode && !isInCheck
      && nodeType != CUT_NODE && nodeType != PV_NODE
      && depth <= 3 && staticEval <= alpha - RAZOR_MARGIN[depth]) {
+        searchStats->razorTries++;
         searchParams->ply = ssi->ply;
-        if (depth == 1)
+        if (depth == 1) {
+            searchStats->razorPrunes++;
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_RAZORING);
             return quiescence(b, 0, alpha, beta, threadID);
+        }
 
         int rWindow = alpha - RAZOR_MARGIN[depth];
         int value = quiescence(b, 0, rWindow, rWindow+1, threadID);
         // Fail hard here to be safe
-        if (value <= rWindow)
+        if (value <= rWindow) {
+            searchStats->razorPrunes++;
+            TRACE_NOTE(threadID, exit, TRACE_EXIT_RAZORING);
             return value;
+        }
     }
 
 
@@ -805,7 +1051,9 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         // Reduce more if we are further ahead
         int reduction = 2 + (32 * depth + std::min(staticEval - beta, 384)) / 128;
 
+        searchStats->nullMoveTries++;
         uint16_t epCaptureFile = b.getEPCaptureFile();
+        threadMemoryArray[threadID]->twoFoldPositions.push(NULL_MOVE_KEY);
         b.doNullMove();
         searchParams->nullMoveCount++;
         (ssi+1)->counterMoveHistory = nullptr;
@@ -814,15 +1062,25 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
         // Undo the null move
         b.undoNullMove(epCaptureFile);
+        threadMemoryArray[threadID]->twoFoldPositions.pop();
         searchParams->nullMoveCount = 0;
 
         if (nullScore >= beta) {
             if (depth >= 10) {
+                searchStats->nullVerifyTries++;
                 int verifyScore = PVS(b, depth-1-reduction, alpha, beta, threadID, false, ssi, &line);
-                if (verifyScore >= beta)
+                if (verifyScore >= beta) {
+                    searchStats->nullVerifyPrunes++;
+                    searchStats->nullMovePrunes++;
+                    TRACE_NOTE(threadID, exit, TRACE_EXIT_NULL_MOVE);
                     return verifyScore;
+                }
+            }
+            else {
+                searchStats->nullMovePrunes++;
+                TRACE_NOTE(threadID, exit, TRACE_EXIT_NULL_MOVE);
+                return nullScore;
             }
-            else return nullScore;
         }
     }
 
@@ -831,13 +1089,23 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     // When there is no hash move available, it is sometimes worth doing a
     // shallow search to try and look for one
     // This is especially true at PV nodes and potential cut nodes
-    if (hashed == NULL_MOVE
+    // With internal iterative reduction enabled, we instead just search the
+    // node at a reduced depth, since our move ordering is likely poor here and
+    // the TT will hopefully have a move by the next iteration.
+    if (hashed == NULL_MOVE && useIIR
+     && ((isPVNode && depth >= 5)
+      || (!isPVNode && depth >= 6 && (isCutNode || staticEval >= beta - 50 - 10*depth)))) {
+        searchStats->iirReductions++;
+        depth -= (isPVNode || depth < 10) ? 1 : 2;
+    }
+    else if (hashed == NULL_MOVE
      && ((isPVNode && depth >= 5)
       || (!isPVNode && depth >= 6 && (isCutNode || staticEval >= beta - 50 - 10*depth)))) {
+        searchStats->iidSearches++;
         int iidDepth = isPVNode ? depth - depth/4 - 1 : (depth - 5) / 2;
         PVS(b, iidDepth, alpha, beta, threadID, isCutNode, ssi, &line);
 
-        uint64_t iidEntry = transpositionTable.get(b);
+        uint64_t iidEntry = threadMemoryArray[threadID]->transTable->get(b);
         if (iidEntry != 0) {
             hashScore = getHashScore(iidEntry);
             nodeType = getHashNodeType(iidEntry);
@@ -869,15 +1137,20 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
     for (Move m = moveSorter.nextMove(); m != NULL_MOVE;
               m = moveSorter.nextMove()) {
         // Check for a timeout
-        if (!isPonderSearch) {
+        if (threadMemoryArray[threadID]->isWorker)
+            checkWorkerLimits(threadMemoryArray[threadID]);
+        else if (!isPonderSearch) {
             uint64_t timeSoFar = getTimeElapsed(startTime);
-            if (timeSoFar > timeLimit) {
-                isStop = true;
+            if (timeSoFar > timeLimit || (nodeLimit && getNodes() >= nodeLimit)) {
+                if (!isStop.exchange(true)) {
+                    recordEvent(threadID, (timeSoFar > timeLimit) ? FLIGHT_TIME_LIMIT : FLIGHT_NODE_LIMIT,
+                        0, 0, NULL_MOVE);
+                }
                 stopSignal = true;
             }
         }
         // Stop condition to help break out as quickly as possible
-        if (stopSignal.load(std::memory_order_relaxed))
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
             return INFTY;
 
         // Conditions for whether to do futility and move count pruning
@@ -889,9 +1162,8 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
                            && !b.isCheckMove(color, m);
 
         // For accessing history tables
-        int startSq = getStartSq(m);
         int endSq = getEndSq(m);
-        int pieceID = b.getPieceOnSquare(color, startSq);
+        int pieceID = moveSorter.currentPiece;
 
         // Used to adjust pruning amount so that PV nodes are pruned slightly less
         int pruneDepth = isPVNode ? depth+1 : depth;
@@ -901,35 +1173,53 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         // If we are already a decent amount of material below alpha, a quiet
         // move probably won't raise our prospects much, so don't bother
         // q-searching it.
-        if (moveIsPrunable
-         && pruneDepth <= 6 && staticEval <= alpha - FUTILITY_MARGIN[pruneDepth])
-            continue;
+        if (moveIsPrunable && pruneDepth <= 6) {
+            searchStats->futilityTries++;
+            if (staticEval <= alpha - FUTILITY_MARGIN[pruneDepth]) {
+                searchStats->futilityPrunes++;
+                TRACE_COUNT(threadID, movesPruned);
+                continue;
+            }
+        }
 
 
         // Move count based pruning / Late move pruning
         // At low depths, moves late in the list with poor history are pruned
         // As used in Fruit/Stockfish:
         // https://chessprogramming.wikispaces.com/Futility+Pruning#MoveCountBasedPruning
-        if (moveIsPrunable
-         && depth <= 12
-         && movesSearched > LMP_MOVE_COUNTS[evalImproving][depth] + (isPVNode ? depth : 0))
-            continue;
+        if (moveIsPrunable && depth <= 12) {
+            searchStats->lmpTries++;
+            if (movesSearched > LMP_MOVE_COUNTS[evalImproving][depth] + (isPVNode ? depth : 0)) {
+                searchStats->lmpPrunes++;
+                TRACE_COUNT(threadID, movesPruned);
+                continue;
+            }
+        }
 
 
         // Prune moves with low history
-        if (moveIsPrunable
-         && depth <= 2
-         && ((ssi->counterMoveHistory != nullptr) ? ssi->counterMoveHistory[pieceID][endSq] : 0) < 3 - 3 * depth * depth
-         && ((ssi->followupMoveHistory != nullptr) ? ssi->followupMoveHistory[pieceID][endSq] : 0) < 3 - 3 * depth * depth)
-            continue;
+        if (moveIsPrunable && depth <= 2) {
+            searchStats->historyPruneTries++;
+            if (((ssi->counterMoveHistory != nullptr) ? ssi->counterMoveHistory[pieceID][endSq] : 0) < 3 - 3 * depth * depth
+             && ((ssi->followupMoveHistory != nullptr) ? ssi->followupMoveHistory[pieceID][endSq] : 0) < 3 - 3 * depth * depth) {
+                searchStats->historyPrunes++;
+                TRACE_COUNT(threadID, movesPruned);
+                continue;
+            }
+        }
 
 
         // Futility pruning using SEE
         if (!isPVNode && !isInCheck
          && bestScore > -MAX_PLY_MATE_SCORE
-         && depth <= 5
-         && b.getSEEForMove(color, m) < -100*depth)
-            continue;
+         && depth <= 5) {
+            searchStats->seePruneTries++;
+            if (!b.seeGE(color, m, -100*depth)) {
+                searchStats->seePrunes++;
+                TRACE_COUNT(threadID, movesPruned);
+                continue;
+            }
+        }
 
 
         // Copy the board and do the move
@@ -982,15 +1272,20 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
             // Do not let search descend directly into q-search
             reduction = std::max(0, std::min(reduction, depth - 2));
+            if (reduction > 0)
+                searchStats->lmrReductions[std::min(reduction, LMR_STAT_REDUCTIONS) - 1]++;
         }
 
 
         int extension = 0;
         // Check extensions
         if (reduction == 0
-         && copy.isInCheck(color^1)
-         && b.getSEEForMove(color, m) >= 0) {
-            extension++;
+         && copy.isInCheck(color^1)) {
+            searchStats->checkExtensionTries++;
+            if (b.seeGE(color, m, 0)) {
+                searchStats->checkExtensions++;
+                extension++;
+            }
         }
 
         // Record two-fold stack since we may do a search for singular extensions
@@ -1003,6 +1298,7 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
          && abs(hashScore) < NEAR_MATE_SCORE
          && (nodeType == CUT_NODE || nodeType == PV_NODE)
          && hashDepth >= depth - 3) {
+            searchStats->singularTries++;
             bool isSingular = true;
 
             // Do a reduced depth search with a lowered window for a fail low check
@@ -1036,8 +1332,10 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
             // If all moves other than the hash move failed low, we extend for
             // the singular move
-            if (isSingular)
+            if (isSingular) {
+                searchStats->singularExtensions++;
                 extension++;
+            }
         }
 
 
@@ -1050,6 +1348,7 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
             // LMR re-search if the reduced search did not fail low
             if (reduction > 0 && score > alpha) {
+                searchStats->lmrResearches[std::min(reduction, LMR_STAT_REDUCTIONS) - 1]++;
                 score = -PVS(copy, depth-1+extension, -alpha-1, -alpha, threadID, !isCutNode, ssi+1, &line);
             }
 
@@ -1068,7 +1367,7 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         threadMemoryArray[threadID]->twoFoldPositions.pop();
 
         // Stop condition to help break out as quickly as possible
-        if (stopSignal.load(std::memory_order_relaxed))
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
             return INFTY;
 
         // Beta cutoff
@@ -1084,9 +1383,9 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
             // Hash the cut move and score
             uint64_t hashData = packHashData(depth, m,
-                adjustHashScore(score, ssi->ply), CUT_NODE,
+                adjustHashScore(score, ssi->ply), ssi->staticEval, CUT_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, depth, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, depth, searchParams->rootMoveNumber);
 
             // Update killers and histories for quiet moves
             if (!isCapture(m)) {
@@ -1101,6 +1400,8 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
 
             changePV(m, pvLine, &line);
 
+            TRACE_NOTE(threadID, movesSearched, movesSearched + 1);
+            TRACE_NOTE(threadID, bestMove, m);
             return score;
         }
 
@@ -1117,6 +1418,8 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         movesSearched++;
     }
     // End main search loop
+    TRACE_NOTE(threadID, movesSearched, movesSearched);
+    TRACE_NOTE(threadID, bestMove, toHash);
 
 
     // If there were no legal moves
@@ -1132,9 +1435,9 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         }
 
         uint64_t hashData = packHashData(depth, toHash,
-            adjustHashScore(alpha, ssi->ply), PV_NODE,
+            adjustHashScore(alpha, ssi->ply), ssi->staticEval, PV_NODE,
             searchParams->rootMoveNumber);
-        transpositionTable.add(b, hashData, depth, searchParams->rootMoveNumber);
+        threadMemoryArray[threadID]->transTable->add(b, hashData, depth, searchParams->rootMoveNumber);
 
         // Update histories for quiet moves
         if (!isCapture(toHash))
@@ -1146,16 +1449,16 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
         // If we had a hash move, save it in case the node becomes a PV or cut node next time
         if (!isPVNode && hashed != NULL_MOVE) {
             uint64_t hashData = packHashData(depth, hashed,
-                adjustHashScore(bestScore, ssi->ply), ALL_NODE,
+                adjustHashScore(bestScore, ssi->ply), ssi->staticEval, ALL_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, depth, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, depth, searchParams->rootMoveNumber);
         }
         // Otherwise, just store no best move as expected
         else {
             uint64_t hashData = packHashData(depth, NULL_MOVE,
-                adjustHashScore(bestScore, ssi->ply), ALL_NODE,
+                adjustHashScore(bestScore, ssi->ply), ssi->staticEval, ALL_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, depth, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, depth, searchParams->rootMoveNumber);
         }
     }
 
@@ -1170,27 +1473,36 @@ int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode,
  * spent here.
  * The search is a fail-soft PVS.
  */
-int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+int searchQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
     SearchParameters *searchParams = &(threadMemoryArray[threadID]->searchParams);
     SearchStatistics *searchStats = &(threadMemoryArray[threadID]->searchStats);
     int color = b.getPlayerToMove();
 
     // If in check, we must consider all legal check evasions
     if (b.isInCheck(color))
-        return checkQuiescence(b, plies, alpha, beta, threadID);
+        return searchCheckQuiescence(b, plies, alpha, beta, threadID);
 
-    if (b.isInsufficientMaterial())
+    if (b.isInsufficientMaterial()) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
         return 0;
+    }
     // Check for repetition draws while we are still considering checks
-    if (b.getFiftyMoveCounter() >= 2 && threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey()))
+    if (b.getFiftyMoveCounter() >= 2 && threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey(), b.getFiftyMoveCounter())) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
         return 0;
+    }
 
     // Qsearch hash table probe
     int hashScore = -INFTY;
-    uint64_t hashEntry = transpositionTable.get(b);
+    int hashEval = INFTY;
+    Move hashed = NULL_MOVE;
+    uint64_t hashEntry = threadMemoryArray[threadID]->transTable->get(b);
     uint8_t nodeType = NO_NODE_INFO;
     if (hashEntry != 0) {
+        TRACE_NOTE(threadID, tt, TRACE_TT_HIT);
         hashScore = getHashScore(hashEntry);
+        hashEval = getHashEval(hashEntry);
+        hashed = getHashMove(hashEntry);
 
         // Adjust the hash score to mate distance from root if necessary
         if (hashScore >= MAX_PLY_MATE_SCORE)
@@ -1205,27 +1517,39 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
             // Check for the correct node type and bounds
             if ((nodeType == ALL_NODE && hashScore <= alpha)
              || (nodeType == CUT_NODE && hashScore >= beta)
-             || (nodeType == PV_NODE))
+             || (nodeType == PV_NODE)) {
+                TRACE_NOTE(threadID, tt, TRACE_TT_CUT);
+                TRACE_NOTE(threadID, exit, TRACE_EXIT_HASH);
                 return hashScore;
+            }
         }
     }
 
 
     // Stand pat: if our current position is already way too good or way too bad
     // we can simply stop the search here.
-    int standPat;
-    // Probe the eval cache for a saved calculation
-    searchStats->evalCacheProbes++;
-    int ehe = evalCache.get(b);
-    if (ehe != 0) {
-        searchStats->evalCacheHits++;
-        standPat = ehe - EVAL_HASH_OFFSET;
+    int staticEval;
+    // Use the static eval saved in the TT entry if possible, otherwise probe
+    // the eval cache for a saved calculation
+    if (useHashEval && hashEval != INFTY) {
+        searchStats->hashEvalHits++;
+        staticEval = hashEval;
     }
     else {
-        Eval e;
-        standPat = (color == WHITE) ? e.evaluate(b) : -e.evaluate(b);
-        evalCache.add(b, standPat);
+        searchStats->evalCacheProbes++;
+        int ehe = threadMemoryArray[threadID]->evalCache->get(b);
+        if (ehe != 0) {
+            searchStats->evalCacheHits++;
+            staticEval = ehe - EVAL_HASH_OFFSET;
+        }
+        else {
+            Eval e;
+            staticEval = (color == WHITE) ? e.evaluate(b) : -e.evaluate(b);
+            threadMemoryArray[threadID]->evalCache->add(b, staticEval);
+        }
     }
+    int standPat = staticEval;
+    TRACE_NOTE(threadID, staticEval, staticEval);
 
     // Use the TT score as a better "static" eval, if available.
     if (hashScore != -INFTY) {
@@ -1236,42 +1560,58 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
     }
 
     // The stand pat cutoff
-    if (standPat >= beta)
+    if (standPat >= beta) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_STAND_PAT);
         return standPat;
+    }
 
+    int prevAlpha = alpha;
     if (alpha < standPat)
         alpha = standPat;
 
     int bestScore = standPat;
+    // Keeps track of the best move for storing into the TT
+    Move toHash = NULL_MOVE;
 
 
-    // Generate captures and order by MVV/LVA
+    // Generate captures and order by MVV/LVA, trying the hash move first if
+    // it is one of our captures
     MoveList legalMoves;
     b.getPseudoLegalCaptures(legalMoves, color, false);
-    ScoreList scores;
+    ExtMoveList captures;
     for (unsigned int i = 0; i < legalMoves.size(); i++) {
-        scores.add(b.getMVVLVAScore(color, legalMoves.get(i)));
+        ExtMove em;
+        em.move = legalMoves.get(i);
+        em.pieceID = b.getPieceOnSquare(color, getStartSq(em.move));
+        em.captured = b.getPieceOnSquare(color^1, getEndSq(em.move));
+        em.score = (em.move == hashed) ? INFTY : b.getMVVLVAScore(em.pieceID, em.captured);
+        captures.add(em);
     }
 
     int score = -INFTY;
     unsigned int i = 0;
     unsigned int j = 0; // separate counter only incremented when valid move is searched
-    for (Move m = nextMove(legalMoves, scores, i); m != NULL_MOVE;
-              m = nextMove(legalMoves, scores, ++i)) {
+    for (ExtMove em = nextMove(captures, i); em.move != NULL_MOVE;
+                 em = nextMove(captures, ++i)) {
+        Move m = em.move;
         // Delta prune
-        int potentialEval = standPat + b.valueOfPiece(b.getPieceOnSquare(color^1, getEndSq(m)));
+        int potentialEval = standPat + b.valueOfPiece(em.captured);
         if (potentialEval < alpha - 130) {
             bestScore = std::max(bestScore, potentialEval + 130);
+            TRACE_COUNT(threadID, movesPruned);
             continue;
         }
         // Futility pruning
-        if (standPat < alpha - 80 && b.getSEEForMove(color, m) <= 0) {
+        if (standPat < alpha - 80 && !b.seeGE(color, m, 1)) {
             bestScore = std::max(bestScore, standPat + 80);
+            TRACE_COUNT(threadID, movesPruned);
             continue;
         }
         // Static exchange evaluation pruning
-        if (b.getExchangeScore(color, m) < 0 && b.getSEEForMove(color, m) < 0)
+        if (b.getExchangeScore(color, m) < 0 && !b.seeGE(color, m, 0)) {
+            TRACE_COUNT(threadID, movesPruned);
             continue;
+        }
 
 
         Board copy = b.staticCopy();
@@ -1283,7 +1623,7 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
         score = -quiescence(copy, plies+1, -beta, -alpha, threadID);
 
         // Stop condition to help break out as quickly as possible
-        if (stopSignal.load(std::memory_order_relaxed))
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
             return INFTY;
 
         if (score >= beta) {
@@ -1292,17 +1632,21 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
                 searchStats->qsFirstFailHighs++;
 
             uint64_t hashData = packHashData(-plies, m,
-                adjustHashScore(score, searchParams->ply + plies), CUT_NODE,
+                adjustHashScore(score, searchParams->ply + plies), staticEval, CUT_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, -plies, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
 
+            TRACE_NOTE(threadID, movesSearched, j + 1);
+            TRACE_NOTE(threadID, bestMove, m);
             return score;
         }
 
         if (score > bestScore) {
             bestScore = score;
-            if (score > alpha)
+            if (score > alpha) {
                 alpha = score;
+                toHash = m;
+            }
         }
 
         j++;
@@ -1315,8 +1659,10 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
         Move m = legalMoves.get(i);
 
         // Static exchange evaluation pruning
-        if (!isCapture(m) && b.getSEEForMove(color, m) < 0)
+        if (!isCapture(m) && !b.seeGE(color, m, 0)) {
+            TRACE_COUNT(threadID, movesPruned);
             continue;
+        }
 
         Board copy = b.staticCopy();
         if (!copy.doPseudoLegalMove(m, color))
@@ -1326,23 +1672,31 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
         searchStats->qsNodes++;
         score = -quiescence(copy, plies+1, -beta, -alpha, threadID);
 
+        // Stop condition to help break out as quickly as possible
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
+            return INFTY;
+
         if (score >= beta) {
             searchStats->qsFailHighs++;
             if (j == 0)
                 searchStats->qsFirstFailHighs++;
 
             uint64_t hashData = packHashData(-plies, m,
-                adjustHashScore(score, searchParams->ply + plies), CUT_NODE,
+                adjustHashScore(score, searchParams->ply + plies), staticEval, CUT_NODE,
                 searchParams->rootMoveNumber);
-            transpositionTable.add(b, hashData, -plies, searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
 
+            TRACE_NOTE(threadID, movesSearched, j + 1);
+            TRACE_NOTE(threadID, bestMove, m);
             return score;
         }
 
         if (score > bestScore) {
             bestScore = score;
-            if (score > alpha)
+            if (score > alpha) {
                 alpha = score;
+                toHash = m;
+            }
         }
 
         j++;
@@ -1361,11 +1715,14 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
                 // Futility pruning
                 if (standPat < alpha - 110) {
                     bestScore = std::max(bestScore, standPat + 110);
+                    TRACE_COUNT(threadID, movesPruned);
                     continue;
                 }
                 // Static exchange evaluation pruning
-                if (b.getSEEForMove(color, m) < 0)
+                if (!b.seeGE(color, m, 0)) {
+                    TRACE_COUNT(threadID, movesPruned);
                     continue;
+                }
 
                 Board copy = b.staticCopy();
                 if (!copy.doPseudoLegalMove(m, color))
@@ -1379,23 +1736,31 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
 
                 threadMemoryArray[threadID]->twoFoldPositions.pop();
 
+                // Stop condition to help break out as quickly as possible
+                if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
+                    return INFTY;
+
                 if (score >= beta) {
                     searchStats->qsFailHighs++;
                     if (j == 0)
                         searchStats->qsFirstFailHighs++;
 
                     uint64_t hashData = packHashData(-plies, m,
-                        adjustHashScore(score, searchParams->ply + plies), CUT_NODE,
+                        adjustHashScore(score, searchParams->ply + plies), staticEval, CUT_NODE,
                         searchParams->rootMoveNumber);
-                    transpositionTable.add(b, hashData, -plies, searchParams->rootMoveNumber);
+                    threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
 
+                    TRACE_NOTE(threadID, movesSearched, j + 1);
+                    TRACE_NOTE(threadID, bestMove, m);
                     return score;
                 }
 
                 if (score > bestScore) {
                     bestScore = score;
-                    if (score > alpha)
+                    if (score > alpha) {
                         alpha = score;
+                        toHash = m;
+                    }
                 }
 
                 j++;
@@ -1405,6 +1770,20 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
             bestScore = std::max(bestScore, standPat + 110);
     }
 
+    TRACE_NOTE(threadID, movesSearched, j);
+    TRACE_NOTE(threadID, bestMove, toHash);
+
+    // Store the full bound information: an exact score if a move raised alpha,
+    // and an upper bound otherwise. Do not overwrite results from the main
+    // search for this position.
+    if (hashEntry == 0 || getHashDepth(hashEntry) <= -plies) {
+        bool isExact = (prevAlpha < alpha && toHash != NULL_MOVE);
+        uint64_t hashData = packHashData(-plies, isExact ? toHash : hashed,
+            adjustHashScore(bestScore, searchParams->ply + plies), staticEval,
+            isExact ? PV_NODE : ALL_NODE, searchParams->rootMoveNumber);
+        threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
+    }
+
     return bestScore;
 }
 
@@ -1412,23 +1791,63 @@ int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
  * When checks are considered in quiescence, the responses must include all moves,
  * not just captures, necessitating this function.
  */
-int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
-    if (b.getFiftyMoveCounter() >= 2 && threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey()))
+int searchCheckQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+    TRACE_NOTE(threadID, flags, TRACE_IN_CHECK);
+    if (b.getFiftyMoveCounter() >= 2 && threadMemoryArray[threadID]->twoFoldPositions.find(b.getZobristKey(), b.getFiftyMoveCounter())) {
+        TRACE_NOTE(threadID, exit, TRACE_EXIT_DRAW);
         return 0;
+    }
 
     SearchParameters *searchParams = &(threadMemoryArray[threadID]->searchParams);
     SearchStatistics *searchStats = &(threadMemoryArray[threadID]->searchStats);
     int color = b.getPlayerToMove();
+
+    // Qsearch hash table probe
+    Move hashed = NULL_MOVE;
+    uint64_t hashEntry = threadMemoryArray[threadID]->transTable->get(b);
+    if (hashEntry != 0) {
+        TRACE_NOTE(threadID, tt, TRACE_TT_HIT);
+        int hashScore = getHashScore(hashEntry);
+        hashed = getHashMove(hashEntry);
+
+        // Adjust the hash score to mate distance from root if necessary
+        if (hashScore >= MAX_PLY_MATE_SCORE)
+            hashScore -= searchParams->ply + plies;
+        else if (hashScore <= -MAX_PLY_MATE_SCORE)
+            hashScore += searchParams->ply + plies;
+
+        uint8_t nodeType = getHashNodeType(hashEntry);
+        if (getHashDepth(hashEntry) >= -plies) {
+            if ((nodeType == ALL_NODE && hashScore <= alpha)
+             || (nodeType == CUT_NODE && hashScore >= beta)
+             || (nodeType == PV_NODE)) {
+                TRACE_NOTE(threadID, tt, TRACE_TT_CUT);
+                TRACE_NOTE(threadID, exit, TRACE_EXIT_HASH);
+                return hashScore;
+            }
+        }
+    }
+
     MoveList legalMoves;
     b.getPseudoLegalCheckEscapes(legalMoves, color);
 
+    // Search the hash move first if it is one of our evasions
+    for (unsigned int i = 1; i < legalMoves.size(); i++) {
+        if (legalMoves.get(i) == hashed) {
+            legalMoves.swap(0, i);
+            break;
+        }
+    }
+
+    int prevAlpha = alpha;
     int bestScore = -INFTY;
     int score = -INFTY;
+    Move toHash = NULL_MOVE;
     unsigned int j = 0; // separate counter only incremented when valid move is searched
     for (unsigned int i = 0; i < legalMoves.size(); i++) {
         Move m = legalMoves.get(i);
 
-        if (bestScore > -INFTY && b.getSEEForMove(color, m) < 0)
+        if (bestScore > -INFTY && !b.seeGE(color, m, 0))
             continue;
 
         Board copy = b.staticCopy();
@@ -1443,22 +1862,39 @@ int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
 
         threadMemoryArray[threadID]->twoFoldPositions.pop();
 
+        // Stop condition to help break out as quickly as possible
+        if (threadMemoryArray[threadID]->stop->load(std::memory_order_relaxed))
+            return INFTY;
+
         if (score >= beta) {
             searchStats->qsFailHighs++;
             if (j == 0)
                 searchStats->qsFirstFailHighs++;
+
+            uint64_t hashData = packHashData(-plies, m,
+                adjustHashScore(score, searchParams->ply + plies), INFTY, CUT_NODE,
+                searchParams->rootMoveNumber);
+            threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
+
+            TRACE_NOTE(threadID, movesSearched, j + 1);
+            TRACE_NOTE(threadID, bestMove, m);
             return score;
         }
 
         if (score > bestScore) {
             bestScore = score;
-            if (score > alpha)
+            if (score > alpha) {
                 alpha = score;
+                toHash = m;
+            }
         }
 
         j++;
     }
 
+    TRACE_NOTE(threadID, movesSearched, j);
+    TRACE_NOTE(threadID, bestMove, toHash);
+
     // If there were no legal moves
     if (bestScore == -INFTY) {
         // We already know we are in check, so it must be a checkmate
@@ -1466,10 +1902,77 @@ int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
         return (-MATE_SCORE + searchParams->ply + plies);
     }
 
+    // Store an exact score if a move raised alpha, and an upper bound otherwise.
+    // Do not overwrite results from the main search for this position.
+    if (hashEntry == 0 || getHashDepth(hashEntry) <= -plies) {
+        bool isExact = (prevAlpha < alpha && toHash != NULL_MOVE);
+        uint64_t hashData = packHashData(-plies, isExact ? toHash : hashed,
+            adjustHashScore(bestScore, searchParams->ply + plies), INFTY,
+            isExact ? PV_NODE : ALL_NODE, searchParams->rootMoveNumber);
+        threadMemoryArray[threadID]->transTable->add(b, hashData, -plies, searchParams->rootMoveNumber);
+    }
+
     return bestScore;
 }
 
 
+#if defined(TRACE)
+// When a trace file is open, these record each node in the thread's trace
+// buffer as the node is left
+int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine) {
+    // Horizon nodes are recorded by quiescence
+    if (!isTracing() || depth <= 0 || ssi->ply >= MAX_DEPTH)
+        return searchPVS(b, depth, alpha, beta, threadID, isCutNode, ssi, pvLine);
+
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    TraceRecord node;
+    uint8_t type = (beta - alpha != 1) ? TRACE_PV_NODE : isCutNode ? TRACE_CUT_NODE : TRACE_ALL_NODE;
+    TraceRecord *parent = tm->trace.enter(&node, ssi->ply, depth, alpha, beta, type);
+    int score = searchPVS(b, depth, alpha, beta, threadID, isCutNode, ssi, pvLine);
+    tm->trace.leave(parent, score, tm->stop->load(std::memory_order_relaxed), threadID);
+    return score;
+}
+
+int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+    if (!isTracing())
+        return searchQuiescence(b, plies, alpha, beta, threadID);
+
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    TraceRecord node;
+    TraceRecord *parent = tm->trace.enter(&node, tm->searchParams.ply + plies, -plies,
+        alpha, beta, TRACE_QSEARCH);
+    int score = searchQuiescence(b, plies, alpha, beta, threadID);
+    tm->trace.leave(parent, score, tm->stop->load(std::memory_order_relaxed), threadID);
+    return score;
+}
+
+int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+    if (!isTracing())
+        return searchCheckQuiescence(b, plies, alpha, beta, threadID);
+
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    TraceRecord node;
+    TraceRecord *parent = tm->trace.enter(&node, tm->searchParams.ply + plies, -plies,
+        alpha, beta, TRACE_QSEARCH);
+    int score = searchCheckQuiescence(b, plies, alpha, beta, threadID);
+    tm->trace.leave(parent, score, tm->stop->load(std::memory_order_relaxed), threadID);
+    return score;
+}
+#else
+int PVS(Board &b, int depth, int alpha, int beta, int threadID, bool isCutNode, SearchStackInfo *ssi, SearchPV *pvLine) {
+    return searchPVS(b, depth, alpha, beta, threadID, isCutNode, ssi, pvLine);
+}
+
+int quiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+    return searchQuiescence(b, plies, alpha, beta, threadID);
+}
+
+int checkQuiescence(Board &b, int plies, int alpha, int beta, int threadID) {
+    return searchCheckQuiescence(b, plies, alpha, beta, threadID);
+}
+#endif
+
+
 //------------------------------------------------------------------------------
 //-----------------------------Search Helpers-----------------------------------
 //------------------------------------------------------------------------------
@@ -1496,6 +1999,438 @@ int adjustHashScore(int score, int plies) {
 }
 
 
+// Cuckoo-based upcoming repetition detection, from Stockfish. Returns true if
+// a position on the stack from within the current search tree can be reached
+// from board b with a single reversible move. Positions at or before the root
+// are not considered.
+bool TwoFoldStack::findUpcoming(Board &b, int plies) {
+    int end = std::min(std::min((int) b.getFiftyMoveCounter(), (int) keys.size()), plies - 1);
+    uint64_t key = b.getZobristKey();
+    for (int i = 3; i <= end; i += 2) {
+        if (keys[keys.size()-i+2] == NULL_MOVE_KEY || keys[keys.size()-i+1] == NULL_MOVE_KEY)
+            return false;
+        if (b.isReversibleMoveKey(key ^ keys[keys.size()-i]))
+            return true;
+    }
+    return false;
+}
+
+
+//------------------------------------------------------------------------------
+//-------------------------------Worker searches--------------------------------
+//------------------------------------------------------------------------------
+
+// Workers run independent single-threaded searches outside of the main search,
+// for batch analysis and server sessions. Their ThreadMemory is kept in slots
+// after the main search threads' memory, so that they can use the same search
+// functions indexed by thread ID. The slots are reserved up front so that the
+// array is never resized while workers are searching.
+static unsigned int firstWorker = 0;
+static std::mutex workerSlotMutex;
+
+// Reserves slots for up to n workers. The main search must not be running.
+void initWorkers(unsigned int n) {
+    std::lock_guard<std::mutex> lock(resizeMutex);
+    firstWorker = threadMemoryArray.size();
+    threadMemoryArray.resize(firstWorker + n, nullptr);
+}
+
+// Deletes all workers and releases their slots
+void freeWorkers() {
+    std::lock_guard<std::mutex> lock(resizeMutex);
+    while (threadMemoryArray.size() > firstWorker) {
+        delete threadMemoryArray.back();
+        threadMemoryArray.pop_back();
+    }
+}
+
+// Creates a worker in a free slot and returns its thread ID, or -1 if all
+// slots are taken. If hashMB is 0 the worker uses the main transposition
+// table, otherwise it gets a private table of that size.
+int newWorker(uint64_t hashMB) {
+    std::lock_guard<std::mutex> lock(workerSlotMutex);
+    for (unsigned int i = firstWorker; i < threadMemoryArray.size(); i++) {
+        if (threadMemoryArray[i] != nullptr)
+            continue;
+
+        ThreadMemory *tm = new ThreadMemory();
+        tm->isWorker = true;
+        if (hashMB == 0)
+            tm->transTable = &transpositionTable;
+        else {
+            tm->privateTransTable = new Hash(hashMB);
+            tm->transTable = tm->privateTransTable;
+        }
+        if (evalCachePerThread) {
+            uint64_t workers = threadMemoryArray.size() - firstWorker;
+            tm->privateEvalCache = new EvalHash(std::max(MIN_HASH_SIZE, evalCacheSize / workers));
+            tm->evalCache = tm->privateEvalCache;
+        }
+        else
+            tm->evalCache = &sharedEvalCache;
+        threadMemoryArray[i] = tm;
+        return i;
+    }
+    return -1;
+}
+
+void deleteWorker(int threadID) {
+    std::lock_guard<std::mutex> lock(workerSlotMutex);
+    delete threadMemoryArray[threadID];
+    threadMemoryArray[threadID] = nullptr;
+}
+
+// Clears a worker's history and private tables, as for a new game
+void clearWorker(int threadID) {
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    tm->searchParams.resetHistoryTable();
+    if (tm->privateTransTable != nullptr)
+        tm->privateTransTable->clear();
+    if (tm->privateEvalCache != nullptr)
+        tm->privateEvalCache->clear();
+}
+
+// Raises a worker's stop signal once its time or node limit is reached
+void checkWorkerLimits(ThreadMemory *tm) {
+    WorkerLimits &limits = tm->workerLimits;
+    if ((limits.nodeLimit && tm->searchStats.nodes >= limits.nodeLimit)
+     || (limits.timeLimit && getTimeElapsed(limits.startTime) >= limits.timeLimit))
+        *(tm->stop) = true;
+}
+
+/**
+ * @brief Prepares a single-threaded iterative deepening search on a worker,
+ * to be run by continueWorkerSearch(). The search ends when the limits in
+ * timeParams are reached or when stop is set, which may be done by another
+ * thread. Time limits count from startTime.
+ */
+void startWorkerSearch(WorkerSearch *ws, int threadID, Board &b, TwoFoldStack &history,
+        TimeManagement *timeParams, ChessTime startTime, std::atomic<bool> *stop) {
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    tm->searchParams.reset();
+    tm->searchStats.reset();
+    tm->searchParams.rootMoveNumber = (uint8_t) (b.getMoveNumber());
+    tm->searchParams.selectiveDepth = 0;
+    tm->twoFoldPositions = history;
+    tm->stop = stop;
+
+    ws->threadID = threadID;
+    ws->board = b.staticCopy();
+    ws->searchMode = timeParams->searchMode;
+    ws->timeLimit = (ws->searchMode == MOVETIME) ? timeParams->allotment
+                  : (ws->searchMode == TIME)     ? timeParams->maxAllotment : 0;
+    ws->softTimeLimit = (ws->searchMode == TIME) ? (uint64_t) (timeParams->allotment * TIME_FACTOR) : 0;
+    ws->nodeLimit = (ws->searchMode == NODES) ? timeParams->allotment : 0;
+    ws->maxDepth = (ws->searchMode == DEPTH) ? std::min(MAX_DEPTH, timeParams->allotment) : MAX_DEPTH;
+    ws->stop = stop;
+    ws->legalMoves = ws->board.getAllLegalMoves(ws->board.getPlayerToMove());
+    ws->rootDepth = 1;
+    ws->bestScore = 0;
+    ws->bestMove = (ws->legalMoves.size() > 0) ? ws->legalMoves.get(0) : NULL_MOVE;
+    ws->ponder = NULL_MOVE;
+    ws->startTime = startTime;
+    ws->timeUsed = getTimeElapsed(startTime);
+    ws->nodes = 0;
+    ws->preemptions = 0;
+    ws->finished = (ws->legalMoves.size() <= 0);
+}
+
+/**
+ * @brief Continues a worker search from where it was suspended. If sliceNodes
+ * is 0, the search runs to the end. Otherwise it is suspended after about
+ * sliceNodes nodes, normally at the end of an iteration. An iteration that
+ * runs far past the slice is interrupted and searched again on the next
+ * slice, with twice the allowance each time so that it eventually completes.
+ * Time limits only count time spent searching, except with a game clock.
+ * Each completed iteration is reported to info.
+ * @return true if the search has finished
+ */
+bool continueWorkerSearch(WorkerSearch *ws, uint64_t sliceNodes, InfoCallback info, void *data) {
+    if (ws->finished)
+        return true;
+
+    int threadID = ws->threadID;
+    ThreadMemory *tm = threadMemoryArray[threadID];
+    std::atomic<bool> *stop = ws->stop;
+    if (ws->searchMode != TIME)
+        ws->startTime = ChessClock::now() - std::chrono::milliseconds(ws->timeUsed);
+
+    uint64_t sliceStart = tm->searchStats.nodes;
+    uint64_t sliceLimit = 0;
+    if (sliceNodes)
+        sliceLimit = sliceStart + (sliceNodes << std::min(ws->preemptions, 16)) * SLICE_PREEMPT_FACTOR;
+    tm->workerLimits.startTime = ws->startTime;
+    tm->workerLimits.timeLimit = ws->timeLimit;
+    tm->workerLimits.nodeLimit = (ws->nodeLimit && sliceLimit) ? std::min(ws->nodeLimit, sliceLimit)
+                                                               : std::max(ws->nodeLimit, sliceLimit);
+
+    Board &b = ws->board;
+    MoveList &legalMoves = ws->legalMoves;
+    while (ws->rootDepth <= ws->maxDepth && !*stop) {
+        int rootDepth = ws->rootDepth;
+        SearchPV pvLine;
+        int aspAlpha = -MATE_SCORE;
+        int aspBeta = MATE_SCORE;
+        int delta = 20 - std::min(rootDepth/3, 10) + abs(ws->bestScore) / 20;
+        if (rootDepth >= 6 && abs(ws->bestScore) < NEAR_MATE_SCORE) {
+            aspAlpha = ws->bestScore - delta;
+            aspBeta = ws->bestScore + delta;
+        }
+
+        // Aspiration loop, as in getBestMove()
+        int score = -INFTY, bestMoveIndex = -1;
+        while (!*stop) {
+            tm->searchParams.reset();
+            pvLine.pvLength = 0;
+            getBestMoveAtDepth(&b, &legalMoves, rootDepth, aspAlpha, aspBeta,
+                &bestMoveIndex, &score, 0, threadID, &pvLine);
+
+            if (bestMoveIndex == -1) {
+                delta *= 2;
+                aspAlpha = (score - delta < -NEAR_MATE_SCORE) ? -MATE_SCORE : score - delta;
+            }
+            else if (score >= aspBeta) {
+                delta *= 2;
+                aspBeta = (score + delta > NEAR_MATE_SCORE) ? MATE_SCORE : score + delta;
+                legalMoves.swap(0, bestMoveIndex);
+            }
+            else break;
+        }
+
+        if (*stop) {
+            // If only the slice allowance ran out, suspend and redo this
+            // iteration later
+            bool limitReached = (ws->nodeLimit && tm->searchStats.nodes >= ws->nodeLimit)
+                || (ws->timeLimit && getTimeElapsed(ws->startTime) >= ws->timeLimit);
+            if (sliceLimit && tm->searchStats.nodes >= sliceLimit && !limitReached) {
+                *stop = false;
+                ws->preemptions++;
+                ws->timeUsed = getTimeElapsed(ws->startTime);
+                ws->nodes = tm->searchStats.nodes;
+                return false;
+            }
+        }
+
+        // Results from an interrupted iteration are only used if a new best
+        // move was found. Its score is then only a lower bound, and the
+        // iteration does not count as completed.
+        if (bestMoveIndex == -1)
+            break;
+        bool interrupted = *stop;
+        legalMoves.swap(0, bestMoveIndex);
+        ws->bestScore = score;
+        ws->bestMove = legalMoves.get(0);
+        ws->ponder = (pvLine.pvLength > 1) ? pvLine.pv[1] : NULL_MOVE;
+        if (!interrupted)
+            ws->rootDepth++;
+        ws->preemptions = 0;
+
+        uint64_t timeSoFar = getTimeElapsed(ws->startTime);
+        if (info != nullptr) {
+            SearchInfo searchInfo;
+            searchInfo.depth = rootDepth;
+            searchInfo.selDepth = tm->searchParams.selectiveDepth;
+            searchInfo.multiPV = 1;
+            setInfoScore(searchInfo, interrupted ? BOUND_LOWER : BOUND_EXACT, ws->bestScore);
+            searchInfo.time = timeSoFar;
+            searchInfo.nodes = tm->searchStats.nodes;
+            searchInfo.nps = 1000 * searchInfo.nodes / timeSoFar;
+            searchInfo.tbhits = tm->searchStats.tbhits;
+            searchInfo.hashfull = tm->transTable->estimateHashfull(tm->searchParams.rootMoveNumber);
+            searchInfo.pvLength = pvLine.pvLength;
+            for (int i = 0; i < pvLine.pvLength; i++)
+                searchInfo.pv[i] = pvLine.pv[i];
+            info(searchInfo, data);
+        }
+
+        // Soft time limit for searches with a game clock
+        if (interrupted || (ws->softTimeLimit && timeSoFar >= ws->softTimeLimit))
+            break;
+        if (sliceNodes && tm->searchStats.nodes - sliceStart >= sliceNodes
+         && ws->rootDepth <= ws->maxDepth) {
+            ws->timeUsed = timeSoFar;
+            ws->nodes = tm->searchStats.nodes;
+            return false;
+        }
+    }
+
+    ws->nodes = tm->searchStats.nodes;
+    ws->finished = true;
+    return true;
+}
+
+/**
+ * @brief Runs a worker search to the end. Each completed iteration is
+ * reported to info, and the result to bestMove.
+ */
+void workerSearch(int threadID, Board &b, TwoFoldStack &history,
+        TimeManagement *timeParams, ChessTime startTime, std::atomic<bool> *stop,
+        InfoCallback info, BestMoveCallback bestMove, void *data) {
+    WorkerSearch ws;
+    startWorkerSearch(&ws, threadID, b, history, timeParams, startTime, stop);
+    continueWorkerSearch(&ws, 0, info, data);
+    bestMove(ws.bestMove, ws.ponder, data);
+}
+
+
+//------------------------------------------------------------------------------
+//-------------------------------Batch analysis---------------------------------
+//------------------------------------------------------------------------------
+
+// Shared state for an analyze command. Positions are read from the input file
+// one at a time as workers become free, and each result is written as soon as
+// it is found, so results may be out of order and are tagged with their line
+// number.
+struct AnalysisJob {
+    std::ifstream in;
+    std::ofstream out;
+    std::mutex inMutex;
+    std::mutex outMutex;
+    uint64_t nextLine;
+    TimeManagement timeParams;
+    uint64_t hashMB;
+    std::atomic<uint64_t> positions;
+    std::atomic<uint64_t> nodes;
+};
+
+// The last completed iteration and final move of an analysis search
+struct AnalysisResult {
+    SearchInfo info;
+    Move bestMove;
+};
+
+// Interrupted iterations are reported as lower bounds, and are skipped so that
+// the result has the depth, score, and PV of a completed iteration
+void collectInfo(const SearchInfo &info, void *data) {
+    if (info.bound == BOUND_EXACT)
+        static_cast<AnalysisResult *>(data)->info = info;
+}
+
+void collectBestMove(Move bestMove, Move ponder, void *data) {
+    static_cast<AnalysisResult *>(data)->bestMove = bestMove;
+}
+
+// Converts an EPD line to a FEN string. EPD records have only the first four
+// FEN fields followed by opcodes, but plain FENs are accepted as well.
+std::string epdToFEN(const std::string &epd) {
+    std::istringstream stream(epd);
+    std::string fields[6];
+    int n = 0;
+    while (n < 6 && stream >> fields[n])
+        n++;
+    if (n < 4)
+        return "";
+
+    std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+    if (n == 6 && std::isdigit(fields[4][0]) && std::isdigit(fields[5][0]))
+        return fen + " " + fields[4] + " " + fields[5];
+    return fen + " 0 1";
+}
+
+// Searches one position on a worker, and returns the result line to be written
+std::string analyzePosition(Board &b, AnalysisJob *job, int threadID) {
+    AnalysisResult result;
+    result.info.depth = 0;
+    result.info.pvLength = 0;
+    setInfoScore(result.info, BOUND_EXACT, 0);
+
+    TwoFoldStack history;
+    std::atomic<bool> stop(false);
+    workerSearch(threadID, b, history, &job->timeParams, ChessClock::now(), &stop,
+        collectInfo, collectBestMove, &result);
+    if (result.bestMove == NULL_MOVE)
+        return "bestmove none";
+
+    SearchInfo &info = result.info;
+    Move bestMove = (info.pvLength > 0) ? info.pv[0] : result.bestMove;
+    std::string line = "bestmove " + moveToString(bestMove)
+                     + " score " + (info.isMate ? "mate " : "cp ") + std::to_string(info.score)
+                     + " depth " + std::to_string(info.depth)
+                     + " nodes " + std::to_string(threadMemoryArray[threadID]->searchStats.nodes);
+    if (info.pvLength > 0)
+        line += " pv";
+    for (int i = 0; i < info.pvLength; i++)
+        line += " " + moveToString(info.pv[i]);
+    return line;
+}
+
+void analysisWorker(AnalysisJob *job) {
+    int threadID = newWorker(job->hashMB);
+    std::string line;
+    while (true) {
+        uint64_t lineNumber;
+        {
+            std::lock_guard<std::mutex> lock(job->inMutex);
+            if (!std::getline(job->in, line))
+                break;
+            lineNumber = ++job->nextLine;
+        }
+
+        std::string fen = epdToFEN(line);
+        if (fen.empty())
+            continue;
+        Board b = fenToBoard(fen);
+        // Skip positions the search cannot handle, such as a missing king
+        std::string result;
+        if (count(b.getPieces(WHITE, KINGS)) != 1 || count(b.getPieces(BLACK, KINGS)) != 1)
+            result = "error invalid position";
+        else
+            result = analyzePosition(b, job, threadID);
+        job->positions++;
+        job->nodes += threadMemoryArray[threadID]->searchStats.nodes;
+
+        std::lock_guard<std::mutex> lock(job->outMutex);
+        job->out << lineNumber << " " << fen << " " << result << "\n";
+        job->out.flush();
+    }
+    deleteWorker(threadID);
+}
+
+/**
+ * @brief Analyzes every position in an EPD file with a fixed depth, node, or
+ * time limit per position. Each worker runs its own single-threaded search
+ * with its own ThreadMemory. The workers share the main transposition table,
+ * or each gets an equal share of the hash size if sharedHash is false.
+ */
+void analyzeEPD(std::string inFile, std::string outFile, int searchMode,
+        uint64_t limit, int workers, bool sharedHash) {
+    AnalysisJob job;
+    job.in.open(inFile);
+    if (!job.in.is_open()) {
+        writeLine("info string Could not open " + inFile);
+        return;
+    }
+    job.out.open(outFile);
+    if (!job.out.is_open()) {
+        writeLine("info string Could not open " + outFile);
+        return;
+    }
+    job.nextLine = 0;
+    job.timeParams.searchMode = searchMode;
+    job.timeParams.allotment = (int) std::min(limit, (uint64_t) INT32_MAX);
+    job.timeParams.maxAllotment = job.timeParams.allotment;
+    job.hashMB = sharedHash ? 0 : std::max(MIN_HASH_SIZE,
+        getHashSize() / workers);
+    job.positions = 0;
+    job.nodes = 0;
+
+    initWorkers(workers);
+    auto startTime = ChessClock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++)
+        threads.push_back(std::thread(analysisWorker, &job));
+    for (unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+    uint64_t time = getTimeElapsed(startTime);
+    freeWorkers();
+
+    cerr << "Positions: " << job.positions << endl;
+    cerr << "Nodes: " << job.nodes << endl;
+    cerr << "Time: " << time << endl;
+    cerr << "Nodes/second: " << 1000 * job.nodes / std::max((uint64_t) 1, time) << endl;
+}
+
+
 // Pondering
 void startPonder() {
     isPonderSearch = true;
@@ -1510,20 +2445,96 @@ void stopPonder() {
 //------------------------------Other functions---------------------------------
 //------------------------------------------------------------------------------
 
+// Sets the time allotments for a search with a game clock. A movesToGo of 0
+// means there is no recurring time control.
+void allocateTime(TimeManagement *timeParams, int timeRemaining, int increment,
+        int movesToGo, int moveNumber, int bufferTime) {
+    timeParams->searchMode = TIME;
+    moveNumber = std::min(ENDGAME_HORIZON_LIMIT, moveNumber);
+
+    int minValue = std::min(timeRemaining, bufferTime) / 100;
+    timeRemaining -= bufferTime;
+    // We can never have negative time
+    timeRemaining = std::max(0, timeRemaining);
+
+    // Use a different movestogo for recurring time controls if necessary
+    int horizon = MOVE_HORIZON - MOVE_HORIZON_DEC * moveNumber / ENDGAME_HORIZON_LIMIT;
+    movesToGo = (movesToGo > 0) ? std::min(horizon, movesToGo) : horizon;
+
+    int value = timeRemaining / movesToGo + increment;
+
+    // Minimum thinking time
+    value = std::max(value, minValue);
+
+    // Use special factors for recurring time controls with movestogo < 8
+    if (increment == 0 && movesToGo < 8) {
+        timeParams->maxAllotment = (int) std::min(value * MAX_TIME_FACTOR, timeRemaining * MAX_USAGE_FACTORS[movesToGo]);
+        timeParams->allotment = std::max(value, (int) (timeRemaining * ALLOTMENT_FACTORS[movesToGo]));
+    }
+    else {
+        timeParams->maxAllotment = (int) std::min(value * MAX_TIME_FACTOR, timeRemaining * 0.95);
+        timeParams->allotment = std::min(value, timeParams->maxAllotment / 3);
+    }
+}
+
 // These functions help to communicate with uci.cpp
 void clearTables() {
     transpositionTable.clear();
-    evalCache.clear();
-    for (int i = 0; i < numThreads; i++)
+    sharedEvalCache.clear();
+    for (int i = 0; i < numThreads; i++) {
         threadMemoryArray[i]->searchParams.resetHistoryTable();
+        if (threadMemoryArray[i]->privateEvalCache != nullptr)
+            threadMemoryArray[i]->privateEvalCache->clear();
+    }
 }
 
 void setHashSize(uint64_t MB) {
+    std::lock_guard<std::mutex> lock(resizeMutex);
     transpositionTable.setSize(MB);
 }
 
+// Returns the size of the transposition table in MB
+uint64_t getHashSize() {
+    return transpositionTable.getSize() * sizeof(HashEntry) / (1 << 20);
+}
+
 void setEvalCacheSize(uint64_t MB) {
-    evalCache.setSize(MB);
+    evalCacheSize = MB;
+    updateEvalCaches();
+}
+
+void setEvalCachePerThread(bool enable) {
+    evalCachePerThread = enable;
+    updateEvalCaches();
+}
+
+bool getEvalCachePerThread() {
+    return evalCachePerThread;
+}
+
+// (Re)allocates the eval caches for the current mode and thread count.
+void updateEvalCaches() {
+    if (evalCachePerThread) {
+        uint64_t threadMB = std::max(MIN_HASH_SIZE, evalCacheSize / threadMemoryArray.size());
+        sharedEvalCache.setSize(MIN_HASH_SIZE);
+        for (unsigned int i = 0; i < threadMemoryArray.size(); i++) {
+            ThreadMemory *tm = threadMemoryArray[i];
+            if (tm->privateEvalCache == nullptr)
+                tm->privateEvalCache = new EvalHash(threadMB);
+            else
+                tm->privateEvalCache->setSize(threadMB);
+            tm->evalCache = tm->privateEvalCache;
+        }
+    }
+    else {
+        sharedEvalCache.setSize(evalCacheSize);
+        for (unsigned int i = 0; i < threadMemoryArray.size(); i++) {
+            ThreadMemory *tm = threadMemoryArray[i];
+            delete tm->privateEvalCache;
+            tm->privateEvalCache = nullptr;
+            tm->evalCache = &sharedEvalCache;
+        }
+    }
 }
 
 uint64_t getNodes() {
@@ -1546,19 +2557,80 @@ void setMultiPV(unsigned int n) {
     multiPV = n;
 }
 
+void setIterationReport(bool enable) {
+    iterationReport = enable;
+}
+
+// Appends iteration reports to the file, or stops writing them if the path is
+// empty. Returns false if the file could not be opened.
+bool setIterationReportFile(std::string path) {
+    if (iterationReportFile.is_open())
+        iterationReportFile.close();
+    if (path.empty())
+        return true;
+    iterationReportFile.open(path, std::ios::app);
+    return iterationReportFile.is_open();
+}
+
+void setIIR(bool enable) {
+    useIIR = enable;
+}
+
+void setHashEval(bool enable) {
+    useHashEval = enable;
+}
+
+void setOwnBook(bool enable) {
+    useOwnBook = enable;
+}
+
+void setBookBestMove(bool enable) {
+    bookBestMove = enable;
+}
+
+// Returns false if the book could not be opened
+bool setBookFile(std::string path) {
+    if (path == "<empty>") {
+        openingBook.close();
+        return true;
+    }
+    return openingBook.open(path);
+}
+
+// Routes search output to the given callbacks instead of stdout. Passing
+// nullptr restores UCI output.
+void setSearchCallbacks(InfoCallback info, BestMoveCallback bestMove, void *data) {
+    infoCallback = info;
+    bestMoveCallback = bestMove;
+    callbackData = data;
+}
+
 void setNumThreads(int n) {
+    std::lock_guard<std::mutex> lock(resizeMutex);
     numThreads = n;
 
-    while ((int) threadMemoryArray.size() < n)
+    while ((int) threadMemoryArray.size() < n) {
         threadMemoryArray.push_back(new ThreadMemory());
+        threadMemoryArray.back()->transTable = &transpositionTable;
+        threadMemoryArray.back()->stop = &stopSignal;
+    }
     while ((int) threadMemoryArray.size() > n) {
         delete threadMemoryArray.back();
         threadMemoryArray.pop_back();
     }
+    updateEvalCaches();
+}
+
+int getNumThreads() {
+    return numThreads;
 }
 
 void initPerThreadMemory() {
+    std::lock_guard<std::mutex> lock(resizeMutex);
     threadMemoryArray.push_back(new ThreadMemory());
+    threadMemoryArray.back()->evalCache = &sharedEvalCache;
+    threadMemoryArray.back()->transTable = &transpositionTable;
+    threadMemoryArray.back()->stop = &stopSignal;
 }
 
 TwoFoldStack *getTwoFoldStackPointer() {
@@ -1569,21 +2641,23 @@ TwoFoldStack *getTwoFoldStackPointer() {
 // Retrieves the next move with the highest score, starting from index using a
 // partial selection sort. This way, the entire list does not have to be sorted
 // if an early cutoff occurs.
-Move nextMove(MoveList &moves, ScoreList &scores, unsigned int index) {
-    if (index >= moves.size())
-        return NULL_MOVE;
+ExtMove nextMove(ExtMoveList &moves, unsigned int index) {
+    if (index >= moves.size()) {
+        ExtMove none;
+        none.move = NULL_MOVE;
+        return none;
+    }
     // Find the index of the next best move
     int bestIndex = index;
-    int bestScore = scores.get(index);
+    int bestScore = moves.get(index).score;
     for (unsigned int i = index + 1; i < moves.size(); i++) {
-        if (scores.get(i) > bestScore) {
+        if (moves.get(i).score > bestScore) {
             bestIndex = i;
-            bestScore = scores.get(bestIndex);
+            bestScore = moves.get(i).score;
         }
     }
     // Swap the best move to the correct position
     moves.swap(bestIndex, index);
-    scores.swap(bestIndex, index);
     return moves.get(index);
 }
 
@@ -1606,6 +2680,178 @@ std::string retrievePV(SearchPV *pvLine) {
     return pvStr;
 }
 
+// Collects the values for an info line of the main search
+SearchInfo getSearchInfo(int depth, unsigned int multiPVNum, int bound, int score,
+        bool tbProbeSuccess, int tbScore, uint64_t timeSoFar, SearchPV *pvLine) {
+    SearchInfo info;
+    info.depth = depth;
+    info.selDepth = getSelectiveDepth();
+    info.multiPV = multiPVNum;
+    setInfoScore(info, bound, score);
+    // Show the tablebase score if we have one
+    if (tbProbeSuccess && bound != BOUND_NONE && !info.isMate)
+        info.score = (tbScore == 0 ? 0 : (score/10 + tbScore)) * 100 / PIECE_VALUES[EG][PAWNS];
+    info.time = timeSoFar;
+    info.nodes = getNodes();
+    info.nps = 1000 * info.nodes / timeSoFar;
+    info.tbhits = getTBHits();
+    info.hashfull = transpositionTable.estimateHashfull(threadMemoryArray[0]->searchParams.rootMoveNumber);
+    info.pvLength = (pvLine != nullptr) ? pvLine->pvLength : 0;
+    for (int i = 0; i < info.pvLength; i++)
+        info.pv[i] = pvLine->pv[i];
+    return info;
+}
+
+// Sets the score of an info report, converted to centipawns, or to moves to
+// mate for exact scores
+void setInfoScore(SearchInfo &info, int bound, int score) {
+    info.bound = bound;
+    info.isMate = false;
+    info.score = 0;
+    if (bound == BOUND_EXACT && score >= MAX_PLY_MATE_SCORE) {
+        // If it is our mate, it takes plies / 2 + 1 moves to mate since
+        // our move ends the game
+        info.isMate = true;
+        info.score = (MATE_SCORE - score) / 2 + 1;
+    }
+    else if (bound == BOUND_EXACT && score <= -MAX_PLY_MATE_SCORE) {
+        // If we are being mated, it takes plies / 2 moves since our
+        // opponent's move ends the game
+        info.isMate = true;
+        info.score = (-MATE_SCORE - score) / 2;
+    }
+    else if (bound != BOUND_NONE) {
+        // Scale score into centipawns using our internal pawn value
+        info.score = score * 100 / PIECE_VALUES[EG][PAWNS];
+    }
+}
+
+// Passes an info report to the info callback, or prints it as a UCI info line
+void reportInfo(const SearchInfo &info) {
+    if (infoCallback != nullptr) {
+        infoCallback(info, callbackData);
+        return;
+    }
+
+    writeInfo(info, multiPV > 1);
+}
+
+// Formats an info report as a UCI info line
+std::string infoToString(const SearchInfo &info, bool showMultiPV) {
+    std::ostringstream line;
+    line << "info depth " << info.depth;
+    line << " seldepth " << info.selDepth;
+    if (info.bound != BOUND_NONE) {
+        if (showMultiPV)
+            line << " multipv " << info.multiPV;
+        line << " score" << (info.isMate ? " mate " : " cp ") << info.score;
+        if (info.bound == BOUND_UPPER)
+            line << " upperbound";
+        else if (info.bound == BOUND_LOWER)
+            line << " lowerbound";
+    }
+    line << " time " << info.time
+         << " nodes " << info.nodes << " nps " << info.nps
+         << " tbhits " << info.tbhits
+         << " hashfull " << info.hashfull;
+    if (info.pvLength > 0) {
+        line << " pv";
+        for (int i = 0; i < info.pvLength; i++)
+            line << " " << moveToString(info.pv[i]);
+    }
+    return line.str();
+}
+
+// Passes the search result to the best move callback, or prints it as a UCI
+// bestmove command. A NULL_MOVE best move means there are no legal moves.
+void reportBestMove(Move bestMove, Move ponder) {
+    if (bestMoveCallback != nullptr) {
+        bestMoveCallback(bestMove, ponder, callbackData);
+        return;
+    }
+
+    if (bestMove == NULL_MOVE)
+        writeLine("bestmove none");
+    else if (ponder != NULL_MOVE)
+        writeLine("bestmove " + moveToString(bestMove) + " ponder " + moveToString(ponder));
+    else
+        writeLine("bestmove " + moveToString(bestMove));
+}
+
+// Prints the iteration report as an info string, and appends it to the report
+// file as a JSON line
+void reportIteration(Board *b, const IterationReport &report) {
+    double ebf = report.prevNodes ? (double) report.nodes / report.prevNodes : 0;
+    double timeRatio = report.prevTime ? (double) report.time / report.prevTime : 0;
+    int score = report.score * 100 / PIECE_VALUES[EG][PAWNS];
+
+    if (iterationReport && infoCallback == nullptr) {
+        OutputLine line;
+        line << "info string iteration depth " << report.depth
+             << (report.complete ? "" : " incomplete")
+             << " nodes " << report.nodes << " time " << report.time
+             << " ebf " << std::fixed << std::setprecision(2) << ebf
+             << " timeratio " << timeRatio
+             << " faillows " << report.failLows << " failhighs " << report.failHighs
+             << " windows";
+        for (unsigned int i = 0; i < report.windows.size(); i++) {
+            line << (i ? "," : " ");
+            if (report.windows[i])
+                line << report.windows[i];
+            else
+                line << "full";
+        }
+        line << " bestmove " << moveToString(report.bestMove)
+             << " changed " << (report.bestMoveChanged ? "true" : "false")
+             << " changes " << report.bestMoveChanges
+             << " threaddepths";
+        for (unsigned int i = 0; i < report.threadDepths.size(); i++)
+            line << (i ? "," : " ") << report.threadDepths[i];
+    }
+
+    if (iterationReportFile.is_open()) {
+        std::ostringstream json;
+        json << std::fixed << std::setprecision(3);
+        json << "{\"search\": " << reportedSearches
+             << ", \"fen\": \"" << boardToFEN(*b) << "\""
+             << ", \"depth\": " << report.depth
+             << ", \"complete\": " << (report.complete ? "true" : "false")
+             << ", \"nodes\": " << report.nodes
+             << ", \"time\": " << report.time
+             << ", \"totalnodes\": " << report.totalNodes
+             << ", \"totaltime\": " << report.totalTime
+             << ", \"ebf\": ";
+        if (report.prevNodes)
+            json << ebf;
+        else
+            json << "null";
+        json << ", \"timeratio\": ";
+        if (report.prevTime)
+            json << timeRatio;
+        else
+            json << "null";
+        json << ", \"score\": " << score
+             << ", \"bestmove\": \"" << moveToString(report.bestMove) << "\""
+             << ", \"bestmovechanged\": " << (report.bestMoveChanged ? "true" : "false")
+             << ", \"bestmovechanges\": " << report.bestMoveChanges
+             << ", \"faillows\": " << report.failLows
+             << ", \"failhighs\": " << report.failHighs
+             << ", \"windows\": [";
+        for (unsigned int i = 0; i < report.windows.size(); i++) {
+            json << (i ? ", " : "");
+            if (report.windows[i])
+                json << report.windows[i];
+            else
+                json << "null";
+        }
+        json << "], \"threaddepths\": [";
+        for (unsigned int i = 0; i < report.threadDepths.size(); i++)
+            json << (i ? ", " : "") << report.threadDepths[i];
+        json << "]}";
+        iterationReportFile << json.str() << endl;
+    }
+}
+
 // The selective depth in a parallel search is the max selective depth reached
 // by any of the threads
 int getSelectiveDepth() {
@@ -1625,25 +2871,102 @@ double getPercentage(uint64_t numerator, uint64_t denominator) {
     return percent;
 }
 
-// Prints the statistics gathered during search
-void printStatistics() {
-    // Aggregate statistics over all threads
+SearchStatistics getSearchStatistics() {
     SearchStatistics searchStats;
+    for (int i = 0; i < numThreads; i++)
+        searchStats.add(threadMemoryArray[i]->searchStats);
+    return searchStats;
+}
+
+SearchStatistics getThreadStatistics(int threadID) {
+    return threadMemoryArray[threadID]->searchStats;
+}
+
+int getThreadSearchDepth(int threadID) {
+    return threadMemoryArray[threadID]->searchDepth;
+}
+
+// Records an event in a search thread's flight recorder
+void recordEvent(int threadID, int type, int depth, int score, Move move) {
+    threadMemoryArray[threadID]->flightRecorder.record(type, getTimeElapsed(startTime),
+        threadMemoryArray[threadID]->searchStats.nodes, depth, score, move);
+}
+
+// Records a stop command. Only called by the input thread, which is the only
+// writer of controlRecorder.
+void recordStopCommand() {
+    std::lock_guard<std::mutex> lock(resizeMutex);
+    controlRecorder.record(FLIGHT_STOP_COMMAND, getTimeElapsed(startTime), getNodes(), 0, 0, NULL_MOVE);
+}
+
+void dumpEvents(std::ostream &out, FlightRecorder &recorder) {
+    uint64_t count = recorder.count.load(std::memory_order_acquire);
+    uint64_t first = (count > (uint64_t) FLIGHT_RECORDER_EVENTS) ? count - FLIGHT_RECORDER_EVENTS : 0;
+    for (uint64_t i = first; i < count; i++) {
+        FlightEvent e = recorder.events[i % FLIGHT_RECORDER_EVENTS];
+        if (e.type < 0 || e.type > FLIGHT_SEARCH_END)
+            continue;
+        out << "  " << std::setw(8) << e.time << " ms  " << FLIGHT_EVENT_NAMES[e.type];
+        if (e.depth)
+            out << " depth " << e.depth;
+        if (e.type == FLIGHT_FAIL_LOW || e.type == FLIGHT_FAIL_HIGH
+         || e.type == FLIGHT_ITERATION_END || e.type == FLIGHT_SEARCH_END)
+            out << " score " << e.score * 100 / PIECE_VALUES[EG][PAWNS];
+        if (e.move != NULL_MOVE)
+            out << " move " << moveToString(e.move);
+        out << " nodes " << e.nodes << endl;
+    }
+}
+
+// Writes the state of the current or last search without stopping it. The
+// counters of running threads are read while they change, so they are only
+// approximate.
+void dumpSearchState(std::ostream &out) {
+    std::ostringstream dump;
+    std::string fen;
+    {
+        std::lock_guard<std::mutex> lock(rootMutex);
+        fen = rootFEN;
+    }
+    std::lock_guard<std::mutex> lock(resizeMutex);
+    uint8_t rootMoveNumber = threadMemoryArray[0]->searchParams.rootMoveNumber;
+
+    dump << "State dump: " << (isStop ? "not searching" : "searching") << endl;
+    dump << "Position: " << (fen.empty() ? "none" : fen) << endl;
+    dump << "Root depth: " << rootDepthSearched << endl;
+    dump << "Elapsed: " << getTimeElapsed(startTime) << " ms";
+    if (timeLimit != MAX_TIME)
+        dump << ", time limit " << timeLimit << " ms";
+    if (nodeLimit)
+        dump << ", node limit " << nodeLimit;
+    dump << endl;
+    dump << "Nodes: " << getNodes() << endl;
+    dump << "Hash: " << getHashSize() << " MB, "
+         << transpositionTable.estimateHashfull(rootMoveNumber) / 10.0 << "% full" << endl;
+
     for (int i = 0; i < numThreads; i++) {
-        searchStats.nodes +=            threadMemoryArray[i]->searchStats.nodes;
-        searchStats.hashProbes +=       threadMemoryArray[i]->searchStats.hashProbes;
-        searchStats.hashHits +=         threadMemoryArray[i]->searchStats.hashHits;
-        searchStats.hashScoreCuts +=    threadMemoryArray[i]->searchStats.hashScoreCuts;
-        searchStats.hashMoveAttempts += threadMemoryArray[i]->searchStats.hashMoveAttempts;
-        searchStats.hashMoveCuts +=     threadMemoryArray[i]->searchStats.hashMoveCuts;
-        searchStats.failHighs +=        threadMemoryArray[i]->searchStats.failHighs;
-        searchStats.firstFailHighs +=   threadMemoryArray[i]->searchStats.firstFailHighs;
-        searchStats.qsNodes +=          threadMemoryArray[i]->searchStats.qsNodes;
-        searchStats.qsFailHighs +=      threadMemoryArray[i]->searchStats.qsFailHighs;
-        searchStats.qsFirstFailHighs += threadMemoryArray[i]->searchStats.qsFirstFailHighs;
-        searchStats.evalCacheProbes +=  threadMemoryArray[i]->searchStats.evalCacheProbes;
-        searchStats.evalCacheHits +=    threadMemoryArray[i]->searchStats.evalCacheHits;
+        ThreadMemory *tm = threadMemoryArray[i];
+        const SearchStatistics &stats = tm->searchStats;
+        dump << "Thread " << i << ": depth " << stats.completedDepth
+             << " seldepth " << tm->searchParams.selectiveDepth
+             << " nodes " << stats.nodes << " qsnodes " << stats.qsNodes
+             << " tbhits " << stats.tbhits
+             << " hashhits " << stats.hashHits << "/" << stats.hashProbes
+             << " failhighs " << stats.failHighs
+             << " firstfailhighs " << stats.firstFailHighs << endl;
+        dumpEvents(dump, tm->flightRecorder);
     }
+    dump << "Commands:" << endl;
+    dumpEvents(dump, controlRecorder);
+
+    out << dump.str();
+    out.flush();
+}
+
+// Prints the statistics gathered during search
+void printStatistics() {
+    // Aggregate statistics over all threads
+    SearchStatistics searchStats = getSearchStatistics();
 
     cerr << std::setw(22) << "Hash hit rate: " << getPercentage(searchStats.hashHits, searchStats.hashProbes)
          << '%' << " of " << searchStats.hashProbes << " probes" << endl;
@@ -1658,5 +2981,38 @@ void printStatistics() {
     cerr << std::setw(22) << "QS FFH rate: " << getPercentage(searchStats.qsFirstFailHighs, searchStats.qsFailHighs)
          << '%' << " of " << searchStats.qsFailHighs << " qs fail highs" << endl;
     cerr << std::setw(22) << "Eval cache hit rate: " << getPercentage(searchStats.evalCacheHits, searchStats.evalCacheProbes)
-         << '%' << " of " << searchStats.evalCacheProbes << " probes" << endl;
+         << '%' << " of " << searchStats.evalCacheProbes << " probes"
+         << (evalCachePerThread ? " (per-thread)" : " (shared)") << endl;
+    cerr << std::setw(22) << "Hash eval hits: " << searchStats.hashEvalHits << " ("
+         << getPercentage(searchStats.hashEvalHits, searchStats.hashEvalHits + searchStats.evalCacheProbes)
+         << '%' << " of static evals)" << endl;
+
+    cerr << std::setw(22) << "Reverse futility: " << getPercentage(searchStats.reverseFutilityPrunes, searchStats.reverseFutilityTries)
+         << '%' << " of " << searchStats.reverseFutilityTries << " nodes" << endl;
+    cerr << std::setw(22) << "Razoring: " << getPercentage(searchStats.razorPrunes, searchStats.razorTries)
+         << '%' << " of " << searchStats.razorTries << " nodes" << endl;
+    cerr << std::setw(22) << "Null move: " << getPercentage(searchStats.nullMovePrunes, searchStats.nullMoveTries)
+         << '%' << " of " << searchStats.nullMoveTries << " null searches" << endl;
+    cerr << std::setw(22) << "Null verification: " << getPercentage(searchStats.nullVerifyPrunes, searchStats.nullVerifyTries)
+         << '%' << " of " << searchStats.nullVerifyTries << " verifications" << endl;
+    cerr << std::setw(22) << "Futility: " << getPercentage(searchStats.futilityPrunes, searchStats.futilityTries)
+         << '%' << " of " << searchStats.futilityTries << " moves" << endl;
+    cerr << std::setw(22) << "Move count (LMP): " << getPercentage(searchStats.lmpPrunes, searchStats.lmpTries)
+         << '%' << " of " << searchStats.lmpTries << " moves" << endl;
+    cerr << std::setw(22) << "History pruning: " << getPercentage(searchStats.historyPrunes, searchStats.historyPruneTries)
+         << '%' << " of " << searchStats.historyPruneTries << " moves" << endl;
+    cerr << std::setw(22) << "SEE pruning: " << getPercentage(searchStats.seePrunes, searchStats.seePruneTries)
+         << '%' << " of " << searchStats.seePruneTries << " moves" << endl;
+    for (int i = 0; i < LMR_STAT_REDUCTIONS; i++) {
+        std::string label = "LMR re-search (" + std::to_string(i + 1)
+                          + (i + 1 == LMR_STAT_REDUCTIONS ? "+" : "") + "): ";
+        cerr << std::setw(22) << label << getPercentage(searchStats.lmrResearches[i], searchStats.lmrReductions[i])
+             << '%' << " of " << searchStats.lmrReductions[i] << " reduced moves" << endl;
+    }
+    cerr << std::setw(22) << "Check extensions: " << getPercentage(searchStats.checkExtensions, searchStats.checkExtensionTries)
+         << '%' << " of " << searchStats.checkExtensionTries << " checks" << endl;
+    cerr << std::setw(22) << "Singular extensions: " << getPercentage(searchStats.singularExtensions, searchStats.singularTries)
+         << '%' << " of " << searchStats.singularTries << " tests" << endl;
+    cerr << std::setw(22) << "IID searches: " << searchStats.iidSearches
+         << ", IIR reductions: " << searchStats.iirReductions << endl;
 }
\ No newline at end of file
@@ -19,51 +19,63 @@
 #ifndef __SEARCH_H__
 #define __SEARCH_H__
 
+#include <algorithm>
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
 #include "board.h"
 #include "common.h"
 #include "timeman.h"
 
+// Placeholder pushed onto the two-fold stack for null moves
+const uint64_t NULL_MOVE_KEY = 0;
+
 /*
- * This struct is a simple stack implementation that stores Zobrist keys to
- * check for two-fold repetition.
+ * This struct is a simple stack that stores Zobrist keys to check for two-fold
+ * repetition.
  * Each time before a move is made, the board position is pushed onto the stack.
  * When the move is unmade or we return back up the search tree, the positions
- * are popped off the stack one by one.
- * The find() function loops through to look for a two-fold repetition. We must
- * only find the first repeat from the top of the stack since we have the
- * condition that the branch terminates immediately returning 0 if two-fold
- * repetition occurs in that branch.
+ * are popped off the stack one by one. Null moves push NULL_MOVE_KEY instead,
+ * since positions before a null move cannot be repeated.
+ * The find() function looks for a two-fold repetition. Only positions with the
+ * same side to move and within the last fiftyMoveCounter plies can repeat, so
+ * we only check every other key, starting from the top of the stack.
+ * The stack grows as needed, and can be presized using the game length.
  */
 struct TwoFoldStack {
 public:
-    uint64_t keys[256];
-    unsigned int length;
+    std::vector<uint64_t> keys;
 
-    TwoFoldStack() {
-        length = 0;
-    }
+    TwoFoldStack() {}
     ~TwoFoldStack() {}
 
-    unsigned int size() { return length; }
+    unsigned int size() { return keys.size(); }
 
-    void push(uint64_t pos) {
-        keys[length] = pos;
-        length++;
-    }
+    void push(uint64_t pos) { keys.push_back(pos); }
 
-    void pop() { length--; }
+    void pop() { keys.pop_back(); }
 
     void clear() {
-        length = 0;
+        keys.clear();
     }
 
-    bool find(uint64_t pos) {
-        for (unsigned int i = length; i > 0; i--) {
-            if (keys[i-1] == pos)
+    void reserve(unsigned int n) {
+        keys.reserve(n);
+    }
+
+    bool find(uint64_t pos, int fiftyMoveCounter) {
+        int end = std::min(fiftyMoveCounter, (int) keys.size());
+        for (int i = 2; i <= end; i += 2) {
+            if (keys[keys.size()-i+1] == NULL_MOVE_KEY)
+                return false;
+            if (keys[keys.size()-i] == pos)
                 return true;
         }
         return false;
     }
+
+    bool findUpcoming(Board &b, int plies);
 };
 
 /**
@@ -76,13 +88,226 @@ struct SearchStackInfo {
     int **followupMoveHistory;
 };
 
+// Score bounds for search info reports
+const int BOUND_NONE = 0;
+const int BOUND_EXACT = 1;
+const int BOUND_UPPER = 2;
+const int BOUND_LOWER = 3;
+
+/**
+ * @brief A progress report from the search, containing the same fields as a
+ * UCI info line. Scores are in centipawns, or in moves to mate if isMate is
+ * set. BOUND_NONE reports have no score or PV.
+ */
+struct SearchInfo {
+    int depth;
+    int selDepth;
+    unsigned int multiPV;
+    int bound;
+    bool isMate;
+    int score;
+    uint64_t time;
+    uint64_t nodes;
+    uint64_t nps;
+    uint64_t tbhits;
+    int hashfull;
+    int pvLength;
+    Move pv[MAX_DEPTH+1];
+};
+
+// LMR statistics are kept for reductions of 1 ply up to this many plies or more
+const int LMR_STAT_REDUCTIONS = 6;
+
+// Records useful statistics which are printed to std::err at the end of each
+// search, and reported per position by bench
+struct SearchStatistics {
+    uint64_t nodes;
+    uint64_t tbhits;
+    uint64_t hashProbes, hashHits, hashScoreCuts;
+    uint64_t hashMoveAttempts, hashMoveCuts;
+    uint64_t failHighs, firstFailHighs;
+    uint64_t qsNodes;
+    uint64_t qsFailHighs, qsFirstFailHighs;
+    uint64_t evalCacheProbes, evalCacheHits;
+    uint64_t hashEvalHits;
+    // Selectivity in PVS. For each pruning technique, the number of nodes or
+    // moves that met its other conditions, and the number pruned.
+    uint64_t reverseFutilityTries, reverseFutilityPrunes;
+    uint64_t razorTries, razorPrunes;
+    uint64_t nullMoveTries, nullMovePrunes;
+    uint64_t nullVerifyTries, nullVerifyPrunes;
+    uint64_t futilityTries, futilityPrunes;
+    uint64_t lmpTries, lmpPrunes;
+    uint64_t historyPruneTries, historyPrunes;
+    uint64_t seePruneTries, seePrunes;
+    // Reduced moves and re-searches, by reduction - 1
+    uint64_t lmrReductions[LMR_STAT_REDUCTIONS], lmrResearches[LMR_STAT_REDUCTIONS];
+    uint64_t checkExtensionTries, checkExtensions;
+    uint64_t singularTries, singularExtensions;
+    uint64_t iidSearches, iirReductions;
+    // The deepest iteration this thread completed
+    int completedDepth;
+
+    SearchStatistics() {
+        reset();
+    }
+
+    void reset() {
+        nodes = 0;
+        tbhits = 0;
+        hashProbes = hashHits = hashScoreCuts = 0;
+        hashMoveAttempts = hashMoveCuts = 0;
+        failHighs = firstFailHighs = 0;
+        qsNodes = 0;
+        qsFailHighs = qsFirstFailHighs = 0;
+        evalCacheProbes = evalCacheHits = 0;
+        hashEvalHits = 0;
+        reverseFutilityTries = reverseFutilityPrunes = 0;
+        razorTries = razorPrunes = 0;
+        nullMoveTries = nullMovePrunes = 0;
+        nullVerifyTries = nullVerifyPrunes = 0;
+        futilityTries = futilityPrunes = 0;
+        lmpTries = lmpPrunes = 0;
+        historyPruneTries = historyPrunes = 0;
+        seePruneTries = seePrunes = 0;
+        for (int i = 0; i < LMR_STAT_REDUCTIONS; i++)
+            lmrReductions[i] = lmrResearches[i] = 0;
+        checkExtensionTries = checkExtensions = 0;
+        singularTries = singularExtensions = 0;
+        iidSearches = iirReductions = 0;
+        completedDepth = 0;
+    }
+
+    // Adds the counts of another thread
+    void add(const SearchStatistics &other) {
+        nodes += other.nodes;
+        tbhits += other.tbhits;
+        hashProbes += other.hashProbes;
+        hashHits += other.hashHits;
+        hashScoreCuts += other.hashScoreCuts;
+        hashMoveAttempts += other.hashMoveAttempts;
+        hashMoveCuts += other.hashMoveCuts;
+        failHighs += other.failHighs;
+        firstFailHighs += other.firstFailHighs;
+        qsNodes += other.qsNodes;
+        qsFailHighs += other.qsFailHighs;
+        qsFirstFailHighs += other.qsFirstFailHighs;
+        evalCacheProbes += other.evalCacheProbes;
+        evalCacheHits += other.evalCacheHits;
+        hashEvalHits += other.hashEvalHits;
+        reverseFutilityTries += other.reverseFutilityTries;
+        reverseFutilityPrunes += other.reverseFutilityPrunes;
+        razorTries += other.razorTries;
+        razorPrunes += other.razorPrunes;
+        nullMoveTries += other.nullMoveTries;
+        nullMovePrunes += other.nullMovePrunes;
+        nullVerifyTries += other.nullVerifyTries;
+        nullVerifyPrunes += other.nullVerifyPrunes;
+        futilityTries += other.futilityTries;
+        futilityPrunes += other.futilityPrunes;
+        lmpTries += other.lmpTries;
+        lmpPrunes += other.lmpPrunes;
+        historyPruneTries += other.historyPruneTries;
+        historyPrunes += other.historyPrunes;
+        seePruneTries += other.seePruneTries;
+        seePrunes += other.seePrunes;
+        for (int i = 0; i < LMR_STAT_REDUCTIONS; i++) {
+            lmrReductions[i] += other.lmrReductions[i];
+            lmrResearches[i] += other.lmrResearches[i];
+        }
+        checkExtensionTries += other.checkExtensionTries;
+        checkExtensions += other.checkExtensions;
+        singularTries += other.singularTries;
+        singularExtensions += other.singularExtensions;
+        iidSearches += other.iidSearches;
+        iirReductions += other.iirReductions;
+        completedDepth = std::max(completedDepth, other.completedDepth);
+    }
+};
+
+// Hooks for embedding the engine. When no callbacks are set, search results
+// are printed to stdout using the UCI protocol.
+typedef void (*InfoCallback)(const SearchInfo &info, void *data);
+typedef void (*BestMoveCallback)(Move bestMove, Move ponder, void *data);
+
 void getBestMove(Board *b, TimeManagement *timeParams, MoveList *movesToSearch);
+void setSearchCallbacks(InfoCallback info, BestMoveCallback bestMove, void *data);
+std::string infoToString(const SearchInfo &info, bool showMultiPV);
+void allocateTime(TimeManagement *timeParams, int timeRemaining, int increment,
+    int movesToGo, int moveNumber, int bufferTime);
+void analyzeEPD(std::string inFile, std::string outFile, int searchMode,
+    uint64_t limit, int workers, bool sharedHash);
+std::string epdToFEN(const std::string &epd);
+
+// Workers: independent single-threaded searches outside of the main search
+void initWorkers(unsigned int n);
+void freeWorkers();
+int newWorker(uint64_t hashMB);
+void deleteWorker(int threadID);
+void clearWorker(int threadID);
+
+/**
+ * @brief The state of a search on a worker between slices. A suspended search
+ * keeps its root moves here and its history tables in the worker's memory, so
+ * it can be continued later from any thread, one thread at a time.
+ */
+struct WorkerSearch {
+    int threadID;
+    Board board;
+    int searchMode;
+    uint64_t timeLimit;
+    uint64_t softTimeLimit;
+    uint64_t nodeLimit;
+    int maxDepth;
+    std::atomic<bool> *stop;
+    MoveList legalMoves;
+    // The next iteration to search
+    int rootDepth;
+    int bestScore;
+    Move bestMove;
+    Move ponder;
+    ChessTime startTime;
+    // Time spent searching before this slice
+    uint64_t timeUsed;
+    // Nodes searched so far
+    uint64_t nodes;
+    // Times the current iteration was interrupted at the end of a slice
+    int preemptions;
+    bool finished;
+};
+
+void startWorkerSearch(WorkerSearch *ws, int threadID, Board &b, TwoFoldStack &history,
+    TimeManagement *timeParams, ChessTime startTime, std::atomic<bool> *stop);
+bool continueWorkerSearch(WorkerSearch *ws, uint64_t sliceNodes, InfoCallback info, void *data);
+void workerSearch(int threadID, Board &b, TwoFoldStack &history,
+    TimeManagement *timeParams, ChessTime startTime, std::atomic<bool> *stop,
+    InfoCallback info, BestMoveCallback bestMove, void *data);
 void clearTables();
 void setHashSize(uint64_t MB);
+uint64_t getHashSize();
 void setEvalCacheSize(uint64_t MB);
+void setEvalCachePerThread(bool enable);
+bool getEvalCachePerThread();
 uint64_t getNodes();
+// Statistics of the last search, summed over all threads
+SearchStatistics getSearchStatistics();
+SearchStatistics getThreadStatistics(int threadID);
+// The last iteration a thread of the last search was searching
+int getThreadSearchDepth(int threadID);
+// Each search thread keeps a flight recorder of its recent iterations and
+// stop events, which is written out by dumpSearchState()
+void recordStopCommand();
+void dumpSearchState(std::ostream &out);
 void setMultiPV(unsigned int n);
+void setIterationReport(bool enable);
+bool setIterationReportFile(std::string path);
+void setIIR(bool enable);
+void setHashEval(bool enable);
+void setOwnBook(bool enable);
+void setBookBestMove(bool enable);
+bool setBookFile(std::string path);
 void setNumThreads(int n);
+int getNumThreads();
 void initPerThreadMemory();
 TwoFoldStack *getTwoFoldStackPointer();
 
@@ -96,6 +321,9 @@ const uint64_t MAX_TIME = (1ULL << 63) - 1;
 
 // Search parameters
 const int EASYMOVE_MARGIN = 150;
+// An iteration is interrupted once it has used this many times a worker
+// search's slice
+const uint64_t SLICE_PREEMPT_FACTOR = 4;
 const int NEAR_MATE_SCORE = 2500;
 // An arbitrary value, but this leaves 266 plies to account for hash table grafting.
 const int MAX_PLY_MATE_SCORE = 32500;
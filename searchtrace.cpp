@@ -0,0 +1,140 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "searchtrace.h"
+
+const char *TRACE_EXIT_NAMES[TRACE_EXIT_REASONS] = {
+    "searched", "draw", "mate distance", "hash", "tablebase",
+    "reverse futility", "razoring", "null move", "stand pat", "stopped"
+};
+
+static std::atomic<bool> tracing(false);
+// Guards the file and the list of buffers. Search threads only take it to
+// write a full buffer.
+static std::mutex traceMutex;
+static FILE *traceFile = nullptr;
+static std::vector<TraceBuffer *> traceBuffers;
+
+TraceBuffer::TraceBuffer() {
+    current = nullptr;
+    threadID = 0;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceBuffers.push_back(this);
+}
+
+TraceBuffer::~TraceBuffer() {
+    flush();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceBuffers.erase(std::find(traceBuffers.begin(), traceBuffers.end(), this));
+}
+
+TraceRecord *TraceBuffer::enter(TraceRecord *node, int ply, int depth, int alpha, int beta,
+        uint8_t type) {
+    std::memset(node, 0, sizeof(TraceRecord));
+    node->alpha = (int16_t) alpha;
+    node->beta = (int16_t) beta;
+    node->staticEval = INT16_MAX;
+    node->ply = (uint8_t) ply;
+    node->depth = (int8_t) depth;
+    node->type = type;
+    TraceRecord *parent = current;
+    current = node;
+    return parent;
+}
+
+void TraceBuffer::leave(TraceRecord *parent, int score, bool stopped, int threadID) {
+    current->score = (int16_t) score;
+    if (stopped)
+        current->exit = TRACE_EXIT_STOPPED;
+    add(*current, threadID);
+    current = parent;
+}
+
+void TraceBuffer::markIteration(int depth, int threadID) {
+    TraceRecord marker;
+    std::memset(&marker, 0, sizeof(marker));
+    marker.depth = (int8_t) depth;
+    marker.type = TRACE_ITERATION;
+    add(marker, threadID);
+}
+
+void TraceBuffer::add(const TraceRecord &record, int threadID) {
+    if (records.empty())
+        records.reserve(TRACE_BUFFER_RECORDS);
+    this->threadID = threadID;
+    records.push_back(record);
+    if (records.size() >= TRACE_BUFFER_RECORDS)
+        flush();
+}
+
+void TraceBuffer::flush() {
+    if (records.empty())
+        return;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (traceFile != nullptr) {
+        TraceBlock block;
+        block.threadID = (uint32_t) threadID;
+        block.records = (uint32_t) records.size();
+        std::fwrite(&block, sizeof(block), 1, traceFile);
+        std::fwrite(records.data(), sizeof(TraceRecord), records.size(), traceFile);
+    }
+    records.clear();
+}
+
+bool openSearchTrace(const std::string &path) {
+    closeSearchTrace();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceFile = std::fopen(path.c_str(), "wb");
+    if (traceFile == nullptr)
+        return false;
+
+    TraceHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    std::fwrite(&header, sizeof(header), 1, traceFile);
+    tracing = true;
+    return true;
+}
+
+// Must not be called during a search
+void closeSearchTrace() {
+    tracing = false;
+    std::vector<TraceBuffer *> buffers;
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        buffers = traceBuffers;
+    }
+    for (unsigned int i = 0; i < buffers.size(); i++)
+        buffers[i]->flush();
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (traceFile != nullptr) {
+        std::fclose(traceFile);
+        traceFile = nullptr;
+    }
+}
+
+bool isTracing() {
+    return tracing.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,145 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SEARCHTRACE_H__
+#define __SEARCHTRACE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * The search trace is a binary file with one record for every node searched,
+ * for offline analysis of the search tree. Recording is only compiled in with
+ * TRACE defined (make USE_TRACE=true), and is turned on by the TraceFile
+ * option.
+ *
+ * The file starts with a TraceHeader, followed by blocks of records. Each
+ * block is a TraceBlock followed by its records, all from one thread. Records
+ * are written as nodes are left, so each thread's records are in post-order:
+ * the children of a node are the records at a greater ply just before it.
+ * All fields are in the byte order of the machine that wrote the trace.
+ */
+
+const char TRACE_MAGIC[4] = {'L', 'T', 'R', 'C'};
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+struct TraceBlock {
+    uint32_t threadID;
+    uint32_t records;
+};
+
+// Node types. Main search nodes are the type PVS expected them to be.
+const uint8_t TRACE_PV_NODE = 0;
+const uint8_t TRACE_CUT_NODE = 1;
+const uint8_t TRACE_ALL_NODE = 2;
+const uint8_t TRACE_QSEARCH = 3;
+// Marks the start of an iteration at the given depth, not a node
+const uint8_t TRACE_ITERATION = 4;
+
+// Flags
+const uint8_t TRACE_IN_CHECK = 1;
+
+// Transposition table results
+const uint8_t TRACE_TT_MISS = 0;
+const uint8_t TRACE_TT_HIT = 1;
+const uint8_t TRACE_TT_CUT = 2;
+
+// Why a node returned
+const uint8_t TRACE_EXIT_SEARCHED = 0;
+const uint8_t TRACE_EXIT_DRAW = 1;
+const uint8_t TRACE_EXIT_MATE_DISTANCE = 2;
+const uint8_t TRACE_EXIT_HASH = 3;
+const uint8_t TRACE_EXIT_TABLEBASE = 4;
+const uint8_t TRACE_EXIT_REVERSE_FUTILITY = 5;
+const uint8_t TRACE_EXIT_RAZORING = 6;
+const uint8_t TRACE_EXIT_NULL_MOVE = 7;
+const uint8_t TRACE_EXIT_STAND_PAT = 8;
+const uint8_t TRACE_EXIT_STOPPED = 9;
+const int TRACE_EXIT_REASONS = 10;
+
+extern const char *TRACE_EXIT_NAMES[TRACE_EXIT_REASONS];
+
+struct TraceRecord {
+    // The window the node was searched with, and the score returned
+    int16_t alpha;
+    int16_t beta;
+    int16_t score;
+    // INFTY (32767) if there was none
+    int16_t staticEval;
+    // The move that failed high or raised alpha, if any
+    uint16_t bestMove;
+    uint8_t ply;
+    // Remaining depth, or minus the number of plies into quiescence search
+    int8_t depth;
+    uint8_t type;
+    uint8_t flags;
+    uint8_t tt;
+    uint8_t exit;
+    // Moves searched, including the one that failed high
+    uint8_t movesSearched;
+    // Moves skipped by futility, move count, history, and SEE pruning
+    uint8_t movesPruned;
+};
+
+static_assert(sizeof(TraceRecord) == 18, "trace records must be packed");
+
+// Per-thread buffer size, in records
+const unsigned int TRACE_BUFFER_RECORDS = 1 << 16;
+
+/*
+ * @brief Buffers the records of one search thread, and writes them to the
+ * trace file as a block when full. The record of the node being searched is
+ * kept on the stack of the recording function, and is reached through current
+ * so that the search can fill in its fields.
+ */
+class TraceBuffer {
+public:
+    TraceRecord *current;
+
+    TraceBuffer();
+    TraceBuffer(const TraceBuffer &other) = delete;
+    TraceBuffer& operator=(const TraceBuffer &other) = delete;
+    ~TraceBuffer();
+
+    // Starts recording a node, and returns the record of its parent
+    TraceRecord *enter(TraceRecord *node, int ply, int depth, int alpha, int beta, uint8_t type);
+    // Finishes the current node and makes the parent current again
+    void leave(TraceRecord *parent, int score, bool stopped, int threadID);
+    void markIteration(int depth, int threadID);
+    void flush();
+
+private:
+    std::vector<TraceRecord> records;
+    int threadID;
+
+    void add(const TraceRecord &record, int threadID);
+};
+
+// Writes the buffers of all threads and closes any open trace first
+bool openSearchTrace(const std::string &path);
+void closeSearchTrace();
+bool isTracing();
+
+#endif
@@ -0,0 +1,350 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "output.h"
+#include "server.h"
+
+#ifdef _WIN32
+
+void runServer(std::string address, int threads, unsigned int maxSessions, bool sharedHash) {
+    writeLine("info string Server mode is not supported on Windows");
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "hash.h"
+#include "scheduler.h"
+#include "search.h"
+#include "timeman.h"
+#include "uci.h"
+
+using std::string;
+
+// Defined in uci.cpp
+void setPosition(string &input, std::vector<string> &inputVector, Board &board,
+    TwoFoldStack *twoFoldPositions, PositionCache *cache);
+void setTimeParams(string &input, std::vector<string> &inputVector, Board &board,
+    TimeManagement *timeParams, int bufferTime);
+void stringToLowerCase(std::string &s);
+
+/*
+ * @brief A UCI session with one client. Each session has its own position and
+ * worker, which holds the session's search state, so sessions only share the
+ * read-only tables and, optionally, the transposition table.
+ * The session thread reads commands, and each go command submits a job to
+ * the scheduler. Output from both is serialized with writeMutex.
+ */
+struct Session {
+    int fd;
+    int threadID;
+    Board board;
+    TwoFoldStack twoFoldPositions;
+    PositionCache positionCache;
+    TimeManagement timeParams;
+    // The scheduler job of the current search, or -1
+    int jobID;
+    std::atomic<bool> searching;
+    std::atomic<bool> finished;
+    std::thread thread;
+    std::mutex writeMutex;
+};
+
+static int listenFd = -1;
+static std::atomic<bool> serverRunning(false);
+static std::list<Session *> sessions;
+// Runs the searches of all sessions on the server's threads
+static SearchScheduler *scheduler = nullptr;
+
+
+// Sends a line to the client. Errors are ignored, since a closed connection
+// is noticed by the session thread.
+void sendLine(Session *s, const string &line) {
+    string data = line + "\n";
+    std::lock_guard<std::mutex> lock(s->writeMutex);
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(s->fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        sent += n;
+    }
+}
+
+void sessionInfo(const SearchInfo &info, void *data) {
+    sendLine(static_cast<Session *>(data), infoToString(info, false));
+}
+
+void sessionBestMove(Move bestMove, Move ponder, void *data) {
+    Session *s = static_cast<Session *>(data);
+    if (bestMove == NULL_MOVE)
+        sendLine(s, "bestmove none");
+    else if (ponder != NULL_MOVE)
+        sendLine(s, "bestmove " + moveToString(bestMove) + " ponder " + moveToString(ponder));
+    else
+        sendLine(s, "bestmove " + moveToString(bestMove));
+    s->searching = false;
+}
+
+// Ends the session's search, if any, and waits for its best move
+void stopSearch(Session *s) {
+    if (s->jobID < 0)
+        return;
+    scheduler->cancel(s->jobID);
+    scheduler->wait(s->jobID);
+    s->jobID = -1;
+}
+
+// Handles one command. Returns false if the session should be closed.
+bool handleCommand(Session *s, string input) {
+    stringToLowerCase(input);
+    std::vector<string> inputVector = split(input, ' ');
+
+    if (input == "quit")
+        return false;
+    if (input == "isready") {
+        sendLine(s, "readyok");
+        return true;
+    }
+    if (input == "stop") {
+        stopSearch(s);
+        return true;
+    }
+    if (input == "shutdown") {
+        serverRunning = false;
+        shutdown(listenFd, SHUT_RDWR);
+        return false;
+    }
+
+    // As with the UCI interface, ignore other input while searching
+    if (s->searching)
+        return true;
+
+    if (input == "uci") {
+        sendLine(s, "id name " + ENGINE_NAME + " " + ENGINE_VERSION);
+        sendLine(s, "id author " + ENGINE_AUTHOR);
+        sendLine(s, "uciok");
+    }
+    else if (input == "ucinewgame") {
+        clearWorker(s->threadID);
+    }
+    else if (input.substr(0, 8) == "position") {
+        setPosition(input, inputVector, s->board, &s->twoFoldPositions, &s->positionCache);
+    }
+    else if (input.substr(0, 2) == "go") {
+        std::vector<string>::iterator it = find(inputVector.begin(), inputVector.end(), "nodes");
+        if (it != inputVector.end() && it+1 != inputVector.end()) {
+            s->timeParams.searchMode = NODES;
+            s->timeParams.allotment = std::stoi(*(it+1));
+        }
+        else
+            setTimeParams(input, inputVector, s->board, &s->timeParams, DEFAULT_BUFFER_TIME);
+        // Non-UCI extension: go ... priority <n>
+        int priority = DEFAULT_JOB_PRIORITY;
+        it = find(inputVector.begin(), inputVector.end(), "priority");
+        if (it != inputVector.end() && it+1 != inputVector.end())
+            priority = std::stoi(*(it+1));
+
+        stopSearch(s);
+        s->searching = true;
+        s->jobID = scheduler->submit(s->threadID, s->board, s->twoFoldPositions,
+            &s->timeParams, ChessClock::now(), priority, sessionInfo, sessionBestMove, s);
+    }
+    else if (input.substr(0, 9) == "setoption") {
+        sendLine(s, "info string Options are set for the whole server");
+    }
+    else if (!input.empty()) {
+        sendLine(s, "info string Invalid command.");
+    }
+    return true;
+}
+
+// Reads and handles commands until the client disconnects or quits
+void sessionLoop(Session *s) {
+    string buffer;
+    char chunk[4096];
+    bool open = true;
+    while (open && serverRunning) {
+        ssize_t n = recv(s->fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            break;
+        buffer.append(chunk, n);
+
+        size_t end;
+        while (open && (end = buffer.find('\n')) != string::npos) {
+            string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line[line.size()-1] == '\r')
+                line.erase(line.size()-1);
+            try {
+                open = handleCommand(s, line);
+            }
+            catch (const std::exception &e) {
+                sendLine(s, "info string Invalid command.");
+            }
+        }
+    }
+
+    stopSearch(s);
+    close(s->fd);
+    s->finished = true;
+}
+
+// Joins and frees sessions whose clients have disconnected
+void reapSessions(bool all) {
+    for (std::list<Session *>::iterator it = sessions.begin(); it != sessions.end(); ) {
+        Session *s = *it;
+        if (!all && !s->finished) {
+            ++it;
+            continue;
+        }
+        s->thread.join();
+        deleteWorker(s->threadID);
+        delete s;
+        it = sessions.erase(it);
+    }
+}
+
+// Opens the listening socket. The address is either a TCP port, which is
+// bound to localhost only, or a path for a Unix domain socket.
+int openListenSocket(const string &address) {
+    bool isPort = !address.empty()
+        && std::all_of(address.begin(), address.end(), [](char c) { return std::isdigit(c); });
+    int fd;
+    if (isPort) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((uint16_t) std::stoi(address));
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    else {
+        sockaddr_un addr;
+        if (address.size() >= sizeof(addr.sun_path))
+            return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        // Remove a stale socket from a previous run, but never other files
+        struct stat st;
+        if (stat(address.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(address.c_str());
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, address.c_str());
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, 64) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Serves UCI sessions over a socket until a client sends "shutdown".
+ * Each session gets its own worker, so up to maxSessions sessions can be
+ * connected. Their searches share the given number of threads in slices,
+ * weighted by the priority given with go. Sessions use the main
+ * transposition table if sharedHash is set, and otherwise each gets an equal
+ * share of the hash size. Engine options are the ones set before the server
+ * was started.
+ */
+void runServer(string address, int threads, unsigned int maxSessions, bool sharedHash) {
+    listenFd = openListenSocket(address);
+    if (listenFd < 0) {
+        OutputLine() << "info string Could not listen on " << address;
+        return;
+    }
+
+    uint64_t hashMB = 0;
+    if (!sharedHash)
+        hashMB = std::max(MIN_HASH_SIZE, getHashSize() / maxSessions);
+    initWorkers(maxSessions);
+    scheduler = new SearchScheduler(threads, DEFAULT_SLICE_NODES);
+    serverRunning = true;
+    OutputLine() << "info string Server listening on " << address;
+
+    while (serverRunning) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        reapSessions(false);
+        if (fd < 0)
+            continue;
+
+        int threadID = newWorker(hashMB);
+        if (threadID < 0) {
+            const char *full = "info string Server full\n";
+            send(fd, full, std::strlen(full), MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+
+        Session *s = new Session();
+        s->fd = fd;
+        s->threadID = threadID;
+        s->board = fenToBoard(STARTPOS);
+        s->timeParams.searchMode = DEPTH;
+        s->timeParams.allotment = MAX_DEPTH;
+        s->jobID = -1;
+        s->searching = false;
+        s->finished = false;
+        sessions.push_back(s);
+        s->thread = std::thread(sessionLoop, s);
+    }
+
+    // Disconnect everyone
+    close(listenFd);
+    if (address.find_first_not_of("0123456789") != string::npos)
+        unlink(address.c_str());
+    for (std::list<Session *>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+        shutdown((*it)->fd, SHUT_RDWR);
+    reapSessions(true);
+    delete scheduler;
+    scheduler = nullptr;
+    freeWorkers();
+    OutputLine() << "info string Server stopped";
+}
+
+#endif
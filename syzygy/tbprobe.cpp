@@ -572,11 +572,11 @@ int probe_dtz(Board &b, int *success) {
 // since the last capture or pawn move.
 static int has_repeated() {
     TwoFoldStack *tfp = getTwoFoldStackPointer();
-    if (tfp->length < 3)
+    if (tfp->size() < 3)
         return false;
 
-    uint64_t pos = tfp->keys[tfp->length-1];
-    for (unsigned int i = tfp->length-1; i > 0; i--) {
+    uint64_t pos = tfp->keys[tfp->size()-1];
+    for (unsigned int i = tfp->size()-1; i > 0; i--) {
         if (tfp->keys[i-1] == pos)
             return true;
     }
@@ -22,7 +22,7 @@
 // Search modes
 const int TIME = 1;
 const int DEPTH = 2;
-// const int NODES = 3;
+const int NODES = 3;
 const int MOVETIME = 4;
 
 // Time management constants
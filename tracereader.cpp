@@ -0,0 +1,272 @@
+/*
+    Laser, a UCI chess engine written in C++11.
+    Copyright 2015-2018 Jeffrey An and Michael An
+
+    Laser is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Laser is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Laser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Reads a search trace written by a TRACE build and prints statistics about
+ * the search tree: the effective branching factor of each iteration, how
+ * often nodes behaved as their expected type, why nodes returned, and how far
+ * quiescence search extends past the horizon.
+ *
+ * Usage: tracereader <trace file>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "searchtrace.h"
+
+using std::cout;
+using std::endl;
+
+const int MAX_QSEARCH_PLIES = 32;
+const char *NODE_TYPE_NAMES[3] = {"PV", "Cut", "All"};
+
+// Counts for main search or quiescence search nodes
+struct NodeCounts {
+    uint64_t nodes;
+    uint64_t failHighs, failLows, exacts;
+    uint64_t stopped;
+    uint64_t tt[3];
+    uint64_t exits[TRACE_EXIT_REASONS];
+    // Nodes that searched moves, the moves searched, and the moves pruned
+    uint64_t expanded, movesSearched, movesPruned;
+    // Fail highs after searching moves, and those on the first move
+    uint64_t moveCuts, firstMoveCuts;
+};
+
+// Iterations of one search are split by the marker records. Aspiration
+// re-searches repeat the marker for the same depth.
+struct ThreadState {
+    int depth;
+    uint64_t nodes;
+    // Nodes of the previous iteration, if it was at depth - 1
+    int prevDepth;
+    uint64_t prevNodes;
+
+    ThreadState() {
+        depth = 0;
+        nodes = 0;
+        prevDepth = 0;
+        prevNodes = 0;
+    }
+};
+
+static NodeCounts typeCounts[3];
+static NodeCounts qsCounts;
+static uint64_t qsPlies[MAX_QSEARCH_PLIES+1];
+static std::map<uint32_t, ThreadState> threads;
+// For each depth, the nodes of iterations at that depth, and of the previous
+// iteration of the same search
+static std::map<int, std::pair<uint64_t, uint64_t>> iterationNodes;
+
+void countNode(NodeCounts &counts, const TraceRecord &r) {
+    counts.nodes++;
+    if (r.exit == TRACE_EXIT_STOPPED) {
+        counts.stopped++;
+        return;
+    }
+    if (r.score >= r.beta)
+        counts.failHighs++;
+    else if (r.score <= r.alpha)
+        counts.failLows++;
+    else
+        counts.exacts++;
+    if (r.tt <= TRACE_TT_CUT)
+        counts.tt[r.tt]++;
+    if (r.exit < TRACE_EXIT_REASONS)
+        counts.exits[r.exit]++;
+    counts.movesPruned += r.movesPruned;
+    if (r.movesSearched > 0) {
+        counts.expanded++;
+        counts.movesSearched += r.movesSearched;
+        if (r.score >= r.beta) {
+            counts.moveCuts++;
+            if (r.movesSearched == 1)
+                counts.firstMoveCuts++;
+        }
+    }
+}
+
+void endIteration(ThreadState &t) {
+    if (t.depth > 1 && t.prevDepth == t.depth - 1) {
+        iterationNodes[t.depth].first += t.nodes;
+        iterationNodes[t.depth].second += t.prevNodes;
+    }
+    t.prevDepth = t.depth;
+    t.prevNodes = t.nodes;
+}
+
+void readRecord(ThreadState &t, const TraceRecord &r) {
+    if (r.type == TRACE_ITERATION) {
+        if (r.depth == t.depth)
+            return;
+        endIteration(t);
+        t.depth = r.depth;
+        t.nodes = 0;
+        return;
+    }
+
+    t.nodes++;
+    if (r.type == TRACE_QSEARCH) {
+        countNode(qsCounts, r);
+        qsPlies[std::min(-r.depth, MAX_QSEARCH_PLIES)]++;
+    }
+    else if (r.type <= TRACE_ALL_NODE)
+        countNode(typeCounts[r.type], r);
+}
+
+double percent(uint64_t numerator, uint64_t denominator) {
+    return denominator ? 100.0 * numerator / denominator : 0.0;
+}
+
+double average(uint64_t total, uint64_t count) {
+    return count ? (double) total / count : 0.0;
+}
+
+void printCounts(const char *name, const NodeCounts &c) {
+    uint64_t finished = c.nodes - c.stopped;
+    cout << std::left << std::setw(6) << name << std::right
+         << std::setw(12) << c.nodes
+         << std::setw(10) << percent(c.failHighs, finished)
+         << std::setw(10) << percent(c.exacts, finished)
+         << std::setw(10) << percent(c.failLows, finished)
+         << std::setw(10) << percent(c.firstMoveCuts, c.moveCuts)
+         << std::setw(10) << average(c.movesSearched, c.expanded)
+         << std::setw(10) << average(c.movesPruned, c.expanded) << endl;
+}
+
+void printExits(const char *name, const NodeCounts &c) {
+    uint64_t finished = c.nodes - c.stopped;
+    cout << name << " exits:" << endl;
+    for (int i = 0; i < TRACE_EXIT_REASONS; i++) {
+        if (c.exits[i] == 0)
+            continue;
+        cout << "  " << std::left << std::setw(18) << TRACE_EXIT_NAMES[i] << std::right
+             << std::setw(12) << c.exits[i] << std::setw(10) << percent(c.exits[i], finished) << '%' << endl;
+    }
+    cout << "  " << std::left << std::setw(18) << "hash hit / cut" << std::right
+         << std::setw(11) << percent(c.tt[TRACE_TT_HIT] + c.tt[TRACE_TT_CUT], finished) << '%'
+         << std::setw(9) << percent(c.tt[TRACE_TT_CUT], finished) << '%' << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: tracereader <trace file>" << endl;
+        return 1;
+    }
+    FILE *file = std::fopen(argv[1], "rb");
+    if (file == nullptr) {
+        std::cerr << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    TraceHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1
+     || std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+     || header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+        std::cerr << argv[1] << " is not a version " << TRACE_VERSION << " search trace" << endl;
+        std::fclose(file);
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    TraceBlock block;
+    uint64_t totalRecords = 0;
+    while (std::fread(&block, sizeof(block), 1, file) == 1) {
+        records.resize(block.records);
+        if (std::fread(records.data(), sizeof(TraceRecord), block.records, file) != block.records) {
+            std::cerr << "Trace is truncated" << endl;
+            break;
+        }
+        ThreadState &t = threads[block.threadID];
+        for (unsigned int i = 0; i < records.size(); i++)
+            readRecord(t, records[i]);
+        totalRecords += block.records;
+    }
+    std::fclose(file);
+    for (auto it = threads.begin(); it != threads.end(); ++it)
+        endIteration(it->second);
+
+    uint64_t mainNodes = 0;
+    for (int i = 0; i < 3; i++)
+        mainNodes += typeCounts[i].nodes;
+
+    cout << std::fixed << std::setprecision(2);
+    cout << "Records: " << totalRecords << " from " << threads.size() << " threads" << endl;
+    cout << "Main search nodes: " << mainNodes << ", quiescence nodes: " << qsCounts.nodes
+         << " (" << average(qsCounts.nodes, mainNodes) << " per main search node)" << endl;
+    cout << endl;
+
+    // For each node type, the rate of fail highs, exact scores, and fail
+    // lows, then the first move cut rate and moves searched and pruned per
+    // node that searched moves
+    cout << "Type         Nodes     High%    Exact%      Low%   1stCut%     Moves    Pruned" << endl;
+    for (int i = 0; i < 3; i++)
+        printCounts(NODE_TYPE_NAMES[i], typeCounts[i]);
+    printCounts("QS", qsCounts);
+    uint64_t cutFinished = typeCounts[TRACE_CUT_NODE].nodes - typeCounts[TRACE_CUT_NODE].stopped;
+    uint64_t allFinished = typeCounts[TRACE_ALL_NODE].nodes - typeCounts[TRACE_ALL_NODE].stopped;
+    cout << "Cut node accuracy: " << percent(typeCounts[TRACE_CUT_NODE].failHighs, cutFinished)
+         << "%, all node accuracy: " << percent(typeCounts[TRACE_ALL_NODE].failLows, allFinished)
+         << '%' << endl;
+    cout << endl;
+
+    for (int i = 0; i < 3; i++)
+        printExits(NODE_TYPE_NAMES[i], typeCounts[i]);
+    printExits("QS", qsCounts);
+    cout << endl;
+
+    // The EBF of each depth is the ratio of the nodes of its iterations to
+    // those of the previous iterations of the same searches
+    cout << "Depth         Nodes    EBF" << endl;
+    double logSum = 0;
+    int ratios = 0;
+    for (auto it = iterationNodes.begin(); it != iterationNodes.end(); ++it) {
+        if (it->second.second == 0)
+            continue;
+        double ebf = (double) it->second.first / it->second.second;
+        cout << std::setw(5) << it->first << std::setw(14) << it->second.first
+             << std::setw(7) << ebf << endl;
+        if (ebf > 0) {
+            logSum += std::log(ebf);
+            ratios++;
+        }
+    }
+    if (ratios)
+        cout << "Mean EBF: " << std::exp(logSum / ratios) << endl;
+    cout << endl;
+
+    // Quiescence explosion: how many nodes are spent at each ply past the
+    // horizon
+    cout << "QS ply        Nodes   Share" << endl;
+    for (int i = 0; i <= MAX_QSEARCH_PLIES; i++) {
+        if (qsPlies[i] == 0)
+            continue;
+        cout << std::setw(5) << i << (i == MAX_QSEARCH_PLIES ? "+" : " ")
+             << std::setw(12) << qsPlies[i]
+             << std::setw(7) << percent(qsPlies[i], qsCounts.nodes) << '%' << endl;
+    }
+    cout << "QS nodes per horizon node: " << average(qsCounts.nodes, qsPlies[0]) << endl;
+
+    return 0;
+}
@@ -19,66 +19,136 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <thread>
 #include <random>
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
 
 #include "common.h"
 #include "bbinit.h"
+#include "bench.h"
 #include "board.h"
+#include "debuglog.h"
 #include "eval.h"
+#include "output.h"
 #include "search.h"
+#include "searchtrace.h"
+#include "server.h"
 #include "timeman.h"
 #include "uci.h"
 #include "syzygy/tbprobe.h"
 
-using std::cout;
 using std::cerr;
 using std::endl;
 using std::string;
 
-const string STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-const std::vector<string> positions = {
-    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -",
-    "r2q4/pp1k1pp1/2p1r1np/5p2/2N5/1P5Q/5PPP/3RR1K1 b - -",
-    "5k2/1qr2pp1/2Np1n1r/QB2p3/2R4p/3PPRPb/PP2P2P/6K1 w - -",
-    "r2r2k1/2p2pp1/p1n4p/1qbnp3/2Q5/1PPP1RPP/3NN2K/R1B5 b - -",
-    "8/3k4/p6Q/pq6/3p4/1P6/P3p1P1/6K1 w - -",
-    "8/8/k7/2B5/P1K5/8/8/1r6 w - -",
-    "8/8/8/p1k4p/P2R3P/2P5/1K6/5q2 w - -",
-    "rnbq1k1r/ppp1ppb1/5np1/1B1pN2p/P2P1P2/2N1P3/1PP3PP/R1BQK2R w KQ -",
-    "4r3/6pp/2p1p1k1/4Q2n/1r2Pp2/8/6PP/2R3K1 w - -",
-    "8/3k2p1/p2P4/P5p1/8/1P1R1P2/5r2/3K4 w - -",
-    "r5k1/1bqnbp1p/r3p1p1/pp1pP3/2pP1P2/P1P2N1P/1P2NBP1/R2Q1RK1 b - -",
-    "r1bqk2r/1ppnbppp/p1np4/4p1P1/4PP2/3P1N1P/PPP5/RNBQKBR1 b Qkq -",
-    "5nk1/6pp/8/pNpp4/P7/1P1Pp3/6PP/6K1 w - -",
-    "2r2rk1/1p2npp1/1q1b1nbp/p2p4/P2N3P/BPN1P3/4BPP1/2RQ1RK1 w - -",
-    "8/2b3p1/4knNp/2p4P/1pPp1P2/1P1P1BPK/8/8 w - -"
-};
-
-
-void setPosition(string &input, std::vector<string> &inputVector, Board &board);
-std::vector<string> split(const string &s, char d);
+void setPosition(string &input, std::vector<string> &inputVector, Board &board,
+    TwoFoldStack *twoFoldPositions, PositionCache *cache);
+void setTimeParams(string &input, std::vector<string> &inputVector, Board &board,
+    TimeManagement *timeParams, int bufferTime);
 Move stringToMove(const string &moveStr, Board &b, bool &reversible);
 string boardToString(Board &board);
 bool equalsIgnoreCase(const std::string &s1, const std::string &s2);
 void stringToLowerCase(std::string &s);
 void clearAll(Board &board);
-uint64_t perft(Board &b, int color, int depth, uint64_t &captures);
+void parseBenchOptions(std::vector<string> &inputVector, std::vector<string> &rawInputVector,
+    BenchOptions &options);
 
 
 static int BUFFER_TIME = DEFAULT_BUFFER_TIME;
+// Set to 1 when a perft suite fails, so that scripts can check for it
+static int exitStatus = 0;
 MoveList movesToSearch;
 TimeManagement timeParams;
 // Declared in search.cpp
 extern std::atomic<bool> isStop;
 extern std::atomic<bool> stopSignal;
 
+// Command types
+const int CMD_UNKNOWN = 0;
+const int CMD_UCI = 1;
+const int CMD_ISREADY = 2;
+const int CMD_UCINEWGAME = 3;
+const int CMD_POSITION = 4;
+const int CMD_GO = 5;
+const int CMD_STOP = 6;
+const int CMD_PONDERHIT = 7;
+const int CMD_SETOPTION = 8;
+const int CMD_QUIT = 9;
+const int CMD_BOARD = 10;
+const int CMD_ANALYZE = 11;
+const int CMD_SERVER = 12;
+const int CMD_PERFT = 13;
+const int CMD_BENCH = 14;
+const int CMD_EVAL = 15;
+const int CMD_POSITIONSTATS = 16;
+const int CMD_SMPBENCH = 17;
+const int CMD_MICROBENCH = 18;
+const int CMD_PERFTSUITE = 19;
+const int CMD_DUMPSTATE = 20;
+
+const std::pair<const char *, int> COMMAND_NAMES[] = {
+    {"uci", CMD_UCI}, {"isready", CMD_ISREADY}, {"ucinewgame", CMD_UCINEWGAME},
+    {"position", CMD_POSITION}, {"go", CMD_GO}, {"stop", CMD_STOP},
+    {"ponderhit", CMD_PONDERHIT}, {"setoption", CMD_SETOPTION}, {"quit", CMD_QUIT},
+    {"board", CMD_BOARD}, {"analyze", CMD_ANALYZE}, {"server", CMD_SERVER},
+    {"perft", CMD_PERFT}, {"bench", CMD_BENCH}, {"eval", CMD_EVAL},
+    {"positionstats", CMD_POSITIONSTATS}, {"smpbench", CMD_SMPBENCH},
+    {"microbench", CMD_MICROBENCH}, {"perftsuite", CMD_PERFTSUITE},
+    {"dumpstate", CMD_DUMPSTATE}
+};
+
+// A line of input, tokenized once when it is read
+struct UCICommand {
+    int type;
+    // The lowercased line and its tokens
+    string input;
+    std::vector<string> tokens;
+    // Tokens in the original case, for file names
+    std::vector<string> rawTokens;
+};
+
+// Input is read on its own thread. While a search runs and nothing is queued,
+// isready, stop, and ponderhit are handled there right away. Everything else
+// is queued in order for the main loop, which runs it once the search has
+// finished. dumpstate is always handled right away.
+static std::deque<UCICommand> commandQueue;
+static std::mutex commandMutex;
+static std::condition_variable commandReady;
+// Whether a search started by go is running, and whether quit was received.
+// Guarded by commandMutex.
+static bool searching = false;
+static bool quitting = false;
+
+UCICommand parseCommand(const string &line);
+void readInput();
+void runSearch(Board *b, TimeManagement *timeParams, MoveList *movesToSearch);
+void stopSearch();
+#ifndef _WIN32
+void handleDumpSignal();
+#endif
+
 
 int main() {
+#ifndef _WIN32
+    // SIGUSR1 dumps the search state. It is blocked before any other threads
+    // start, so that only handleDumpSignal() receives it.
+    sigset_t dumpSignal;
+    sigemptyset(&dumpSignal);
+    sigaddset(&dumpSignal, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &dumpSignal, nullptr);
+    std::thread(handleDumpSignal).detach();
+#endif
+
     initMagicTables(2563762638929852183ULL);
     initPSQT();
     initZobristTable();
@@ -88,52 +158,75 @@ int main() {
     setMultiPV(DEFAULT_MULTI_PV);
     setNumThreads(DEFAULT_THREADS);
 
-    string input;
-    std::vector<string> inputVector;
-    string name = "Laser";
-    string version = "1.6 beta";
-    string author = "Jeffrey An and Michael An";
     std::thread searchThread;
 
     Board board = fenToBoard(STARTPOS);
+    PositionCache positionCache;
 
-    cout << name << " " << version << " by " << author << endl;
+    OutputLine() << ENGINE_NAME << " " << ENGINE_VERSION << " by " << ENGINE_AUTHOR;
 
-    while (input != "quit") {
-        getline(std::cin, input);
-        stringToLowerCase(input);
-        inputVector = split(input, ' ');
-        std::cin.clear();
+    std::thread(readInput).detach();
 
-        // Ignore all input other than "stop" and "ponderhit" while running a search.
-        if (!isStop && input != "stop" && input != "ponderhit")
-            continue;
-
-        if (input == "uci") {
-            cout << "id name " << name << " " << version << endl;
-            cout << "id author " << author << endl;
-            cout << "option name Threads type spin default " << DEFAULT_THREADS
-                 << " min " << MIN_THREADS << " max " << MAX_THREADS << endl;
-            cout << "option name Hash type spin default " << DEFAULT_HASH_SIZE
-                 << " min " << MIN_HASH_SIZE << " max " << MAX_HASH_SIZE << endl;
-            cout << "option name EvalCache type spin default " << DEFAULT_HASH_SIZE
-                 << " min " << MIN_HASH_SIZE << " max " << MAX_HASH_SIZE << endl;
-            cout << "option name Ponder type check default false" << endl;
-            cout << "option name MultiPV type spin default " << DEFAULT_MULTI_PV
-                 << " min " << MIN_MULTI_PV << " max " << MAX_MULTI_PV << endl;
-            cout << "option name BufferTime type spin default " << DEFAULT_BUFFER_TIME
-                 << " min " << MIN_BUFFER_TIME << " max " << MAX_BUFFER_TIME << endl;
-            cout << "option name SyzygyPath type string default <empty>" << endl;
-            cout << "option name ScaleMaterial type spin default " << DEFAULT_EVAL_SCALE
-                 << " min " << MIN_EVAL_SCALE << " max " << MAX_EVAL_SCALE << endl;
-            cout << "option name ScaleKingSafety type spin default " << DEFAULT_EVAL_SCALE
-                 << " min " << MIN_EVAL_SCALE << " max " << MAX_EVAL_SCALE << endl;
-            cout << "uciok" << endl;
+    while (true) {
+        UCICommand command;
+        {
+            std::unique_lock<std::mutex> lock(commandMutex);
+            commandReady.wait(lock, [] { return !commandQueue.empty(); });
+            command = std::move(commandQueue.front());
+            commandQueue.pop_front();
+        }
+        if (command.type == CMD_QUIT)
+            break;
+
+        // Other than isready, stop, and ponderhit, queued commands wait for
+        // the search
+        if (command.type != CMD_ISREADY && command.type != CMD_STOP
+         && command.type != CMD_PONDERHIT && searchThread.joinable())
+            searchThread.join();
+
+        string &input = command.input;
+        std::vector<string> &inputVector = command.tokens;
+        std::vector<string> &rawInputVector = command.rawTokens;
+
+        if (command.type == CMD_UCI) {
+            OutputLine() << "id name " << ENGINE_NAME << " " << ENGINE_VERSION;
+            OutputLine() << "id author " << ENGINE_AUTHOR;
+            OutputLine() << "option name Threads type spin default " << DEFAULT_THREADS
+                         << " min " << MIN_THREADS << " max " << MAX_THREADS;
+            OutputLine() << "option name Hash type spin default " << DEFAULT_HASH_SIZE
+                         << " min " << MIN_HASH_SIZE << " max " << MAX_HASH_SIZE;
+            OutputLine() << "option name EvalCache type spin default " << DEFAULT_HASH_SIZE
+                         << " min " << MIN_HASH_SIZE << " max " << MAX_HASH_SIZE;
+            OutputLine() << "option name EvalCachePerThread type check default false";
+            OutputLine() << "option name Ponder type check default false";
+            OutputLine() << "option name MultiPV type spin default " << DEFAULT_MULTI_PV
+                         << " min " << MIN_MULTI_PV << " max " << MAX_MULTI_PV;
+            OutputLine() << "option name BufferTime type spin default " << DEFAULT_BUFFER_TIME
+                         << " min " << MIN_BUFFER_TIME << " max " << MAX_BUFFER_TIME;
+            OutputLine() << "option name MinInfoInterval type spin default " << DEFAULT_INFO_INTERVAL
+                         << " min " << MIN_INFO_INTERVAL << " max " << MAX_INFO_INTERVAL;
+            OutputLine() << "option name SyzygyPath type string default <empty>";
+            OutputLine() << "option name OwnBook type check default false";
+            OutputLine() << "option name BookFile type string default <empty>";
+            OutputLine() << "option name BookBestMove type check default false";
+            OutputLine() << "option name DebugLogFile type string default <empty>";
+            OutputLine() << "option name IterationReport type check default false";
+            OutputLine() << "option name IterationReportFile type string default <empty>";
+#if defined(TRACE)
+            OutputLine() << "option name TraceFile type string default <empty>";
+#endif
+            OutputLine() << "option name InternalIterativeReduction type check default false";
+            OutputLine() << "option name HashStaticEval type check default true";
+            OutputLine() << "option name ScaleMaterial type spin default " << DEFAULT_EVAL_SCALE
+                         << " min " << MIN_EVAL_SCALE << " max " << MAX_EVAL_SCALE;
+            OutputLine() << "option name ScaleKingSafety type spin default " << DEFAULT_EVAL_SCALE
+                         << " min " << MIN_EVAL_SCALE << " max " << MAX_EVAL_SCALE;
+            OutputLine() << "uciok";
         }
-        else if (input == "isready") cout << "readyok" << endl;
-        else if (input == "ucinewgame") clearAll(board);
-        else if (input.substr(0, 8) == "position") setPosition(input, inputVector, board);
-        else if (input.substr(0, 2) == "go" && isStop) {
+        else if (command.type == CMD_ISREADY) OutputLine() << "readyok";
+        else if (command.type == CMD_UCINEWGAME) clearAll(board);
+        else if (command.type == CMD_POSITION) setPosition(input, inputVector, board, getTwoFoldStackPointer(), &positionCache);
+        else if (command.type == CMD_GO) {
             std::vector<string>::iterator it;
 
             if (input.find("ponder") != string::npos)
@@ -152,88 +245,28 @@ int main() {
                 }
             }
 
-            if (input.find("movetime") != string::npos && inputVector.size() > 2) {
-                timeParams.searchMode = MOVETIME;
-                it = find(inputVector.begin(), inputVector.end(), "movetime");
-                it++;
-                timeParams.allotment = std::stoi(*it);
-            }
-            else if (input.find("depth") != string::npos && inputVector.size() > 2) {
-                timeParams.searchMode = DEPTH;
-                it = find(inputVector.begin(), inputVector.end(), "depth");
-                it++;
-                timeParams.allotment = std::min(MAX_DEPTH, std::stoi(*it));
-            }
-            else if (input.find("infinite") != string::npos) {
-                timeParams.searchMode = DEPTH;
-                timeParams.allotment = MAX_DEPTH;
-            }
-            else if (input.find("wtime") != string::npos
-                  || input.find("btime") != string::npos) {
-                timeParams.searchMode = TIME;
-                int color = board.getPlayerToMove();
-                int moveNumber = std::min(ENDGAME_HORIZON_LIMIT, (int) board.getMoveNumber());
-
-                it = find(inputVector.begin(), inputVector.end(), (color == WHITE) ? "wtime" : "btime");
-                it++;
-                int timeRemaining = std::stoi(*it);
-                int minValue = std::min(timeRemaining, BUFFER_TIME) / 100;
-                timeRemaining -= BUFFER_TIME;
-                // We can never have negative time
-                timeRemaining = std::max(0, timeRemaining);
+            setTimeParams(input, inputVector, board, &timeParams, BUFFER_TIME);
 
-                int movesToGo = MOVE_HORIZON - MOVE_HORIZON_DEC * moveNumber / ENDGAME_HORIZON_LIMIT;
-
-                // Parse recurring time controls, and set a different movestogo if necessary
-                it = find(inputVector.begin(), inputVector.end(), "movestogo");
-                if (it != inputVector.end()) {
-                    it++;
-                    movesToGo = std::min(movesToGo, std::stoi(*it));
-                }
-
-                int value = timeRemaining / movesToGo;
-
-                // Parse the increment if available
-                int increment = 0;
-                it = find(inputVector.begin(), inputVector.end(), (color == WHITE) ? "winc" : "binc");
-                if (it != inputVector.end()) {
-                    it++;
-                    increment = std::stoi(*it);
-                }
-                value += increment;
-
-                // Minimum thinking time
-                value = std::max(value, minValue);
-
-                // Use special factors for recurring time controls with movestogo < 8
-                if (increment == 0 && movesToGo < 8) {
-                    timeParams.maxAllotment = (int) std::min(value * MAX_TIME_FACTOR, timeRemaining * MAX_USAGE_FACTORS[movesToGo]);
-                    timeParams.allotment = std::max(value, (int) (timeRemaining * ALLOTMENT_FACTORS[movesToGo]));
-                }
-                else {
-                    timeParams.maxAllotment = (int) std::min(value * MAX_TIME_FACTOR, timeRemaining * 0.95);
-                    timeParams.allotment = std::min(value, timeParams.maxAllotment / 3);
-                }
+            // Start the search with the lock held, so that the input thread
+            // cannot handle a stop or quit before the search has started
+            std::lock_guard<std::mutex> lock(commandMutex);
+            if (!quitting) {
+                isStop = false;
+                stopSignal = false;
+                searching = true;
+                searchThread = std::thread(runSearch, &board, &timeParams, &movesToSearch);
             }
-
-            isStop = false;
-            stopSignal = false;
-            searchThread = std::thread(getBestMove, &board, &timeParams, &movesToSearch);
-            searchThread.detach();
         }
-        else if (input == "ponderhit") {
+        else if (command.type == CMD_PONDERHIT) {
             stopPonder();
         }
 
-        else if (input == "stop") {
-            stopPonder();
-            isStop = true;
-            stopSignal = true;
-            std::this_thread::yield();
+        else if (command.type == CMD_STOP) {
+            stopSearch();
         }
-        else if (input.substr(0, 9) == "setoption" && inputVector.size() >= 5) {
+        else if (command.type == CMD_SETOPTION && inputVector.size() >= 5) {
             if (inputVector.at(1) != "name" || inputVector.at(3) != "value") {
-                cout << "info string Invalid option format." << endl;
+                OutputLine() << "info string Invalid option format.";
             }
             else {
                 if (inputVector.at(2) == "threads") {
@@ -260,6 +293,9 @@ int main() {
                         MB = MAX_HASH_SIZE;
                     setEvalCacheSize(MB);
                 }
+                else if (inputVector.at(2) == "evalcacheperthread") {
+                    setEvalCachePerThread(inputVector.at(4) == "true");
+                }
                 else if (inputVector.at(2) == "ponder") {
                     // do nothing
                 }
@@ -278,6 +314,14 @@ int main() {
                     if (BUFFER_TIME > MAX_BUFFER_TIME)
                         BUFFER_TIME = MAX_BUFFER_TIME;
                 }
+                else if (inputVector.at(2) == "mininfointerval") {
+                    int interval = std::stoi(inputVector.at(4));
+                    if (interval < MIN_INFO_INTERVAL)
+                        interval = MIN_INFO_INTERVAL;
+                    if (interval > MAX_INFO_INTERVAL)
+                        interval = MAX_INFO_INTERVAL;
+                    setInfoInterval(interval);
+                }
                 else if (inputVector.at(2) == "syzygypath") {
                     string path = inputVector.at(4);
                     for (unsigned int i = 5; i < inputVector.size(); i++) {
@@ -288,6 +332,61 @@ int main() {
                     init_tablebases(c_path);
                     free(c_path);
                 }
+                else if (inputVector.at(2) == "ownbook") {
+                    setOwnBook(inputVector.at(4) == "true");
+                }
+                else if (inputVector.at(2) == "bookfile") {
+                    string path = inputVector.at(4);
+                    for (unsigned int i = 5; i < inputVector.size(); i++) {
+                        path += string(" ") + inputVector.at(i);
+                    }
+                    if (!setBookFile(path))
+                        OutputLine() << "info string Could not open book file " << path;
+                }
+                else if (inputVector.at(2) == "debuglogfile") {
+                    string path = rawInputVector.at(4);
+                    for (unsigned int i = 5; i < rawInputVector.size(); i++) {
+                        path += string(" ") + rawInputVector.at(i);
+                    }
+                    if (path == "<empty>")
+                        closeDebugLog();
+                    else if (!openDebugLog(path))
+                        OutputLine() << "info string Could not open debug log file " << path;
+                }
+#if defined(TRACE)
+                else if (inputVector.at(2) == "tracefile") {
+                    string path = rawInputVector.at(4);
+                    for (unsigned int i = 5; i < rawInputVector.size(); i++) {
+                        path += string(" ") + rawInputVector.at(i);
+                    }
+                    if (path == "<empty>")
+                        closeSearchTrace();
+                    else if (!openSearchTrace(path))
+                        OutputLine() << "info string Could not open trace file " << path;
+                }
+#endif
+                else if (inputVector.at(2) == "iterationreport") {
+                    setIterationReport(inputVector.at(4) == "true");
+                }
+                else if (inputVector.at(2) == "iterationreportfile") {
+                    string path = rawInputVector.at(4);
+                    for (unsigned int i = 5; i < rawInputVector.size(); i++) {
+                        path += string(" ") + rawInputVector.at(i);
+                    }
+                    if (path == "<empty>")
+                        setIterationReportFile("");
+                    else if (!setIterationReportFile(path))
+                        OutputLine() << "info string Could not open iteration report file " << path;
+                }
+                else if (inputVector.at(2) == "bookbestmove") {
+                    setBookBestMove(inputVector.at(4) == "true");
+                }
+                else if (inputVector.at(2) == "internaliterativereduction") {
+                    setIIR(inputVector.at(4) == "true");
+                }
+                else if (inputVector.at(2) == "hashstaticeval") {
+                    setHashEval(inputVector.at(4) == "true");
+                }
                 else if (inputVector.at(2) == "scalematerial") {
                     int scale = std::stoi(inputVector.at(4));
                     if (scale < MIN_EVAL_SCALE)
@@ -305,13 +404,47 @@ int main() {
                     setKingSafetyScale(scale);
                 }
                 else
-                    cout << "info string Invalid option." << endl;
+                    OutputLine() << "info string Invalid option.";
             }
         }
 
         //----------------------------Non-UCI Commands--------------------------
-        else if (input == "board") cerr << boardToString(board);
-        else if (input.substr(0, 5) == "perft" && inputVector.size() == 2) {
+        else if (command.type == CMD_BOARD) cerr << boardToString(board);
+        // analyze <epdfile> <outfile> depth|nodes|movetime <n> [threads <n>] [hash shared|private]
+        else if (command.type == CMD_ANALYZE && inputVector.size() >= 5) {
+            int searchMode = (inputVector.at(3) == "nodes") ? NODES
+                           : (inputVector.at(3) == "movetime") ? MOVETIME : DEPTH;
+            uint64_t limit = std::stoull(inputVector.at(4));
+            int workers = std::max(1, (int) std::thread::hardware_concurrency());
+            bool sharedHash = true;
+            std::vector<string>::iterator it = find(inputVector.begin(), inputVector.end(), "threads");
+            if (it != inputVector.end() && it+1 != inputVector.end())
+                workers = std::min(MAX_THREADS, std::max(1, std::stoi(*(it+1))));
+            it = find(inputVector.begin(), inputVector.end(), "hash");
+            if (it != inputVector.end() && it+1 != inputVector.end())
+                sharedHash = (*(it+1) != "private");
+
+            analyzeEPD(rawInputVector.at(1), rawInputVector.at(2), searchMode,
+                       limit, workers, sharedHash);
+        }
+        // server <socketpath|port> [threads <n>] [sessions <n>] [hash shared|private]
+        else if (command.type == CMD_SERVER && inputVector.size() >= 2) {
+            int threads = std::max(1, (int) std::thread::hardware_concurrency());
+            unsigned int sessions = DEFAULT_SERVER_SESSIONS;
+            bool sharedHash = true;
+            std::vector<string>::iterator it = find(inputVector.begin(), inputVector.end(), "threads");
+            if (it != inputVector.end() && it+1 != inputVector.end())
+                threads = std::min(MAX_THREADS, std::max(1, std::stoi(*(it+1))));
+            it = find(inputVector.begin(), inputVector.end(), "sessions");
+            if (it != inputVector.end() && it+1 != inputVector.end())
+                sessions = std::min(MAX_SERVER_SESSIONS, (unsigned int) std::max(1, std::stoi(*(it+1))));
+            it = find(inputVector.begin(), inputVector.end(), "hash");
+            if (it != inputVector.end() && it+1 != inputVector.end())
+                sharedHash = (*(it+1) != "private");
+
+            runServer(rawInputVector.at(1), threads, sessions, sharedHash);
+        }
+        else if (command.type == CMD_PERFT && inputVector.size() == 2) {
             int depth = std::stoi(inputVector.at(1));
 
             uint64_t captures = 0;
@@ -326,105 +459,305 @@ int main() {
             cerr << "Time: " << time << endl;
             cerr << "Nodes/second: " << 1000 * nodes / time << endl;
         }
-        else if (input.substr(0, 5) == "bench") {
-            auto startTime = ChessClock::now();
-            uint64_t totalNodes = 0;
-            movesToSearch.clear();
-            timeParams.searchMode = DEPTH;
-            timeParams.allotment = 11;
+        // bench [depth] or
+        // bench [file <path>] [depth|nodes|movetime <n>] [threads <n>[,<n>...]]
+        //       [format text|json|csv] [output <path>]
+        else if (command.type == CMD_BENCH) {
+            BenchOptions options;
+            options.threads.push_back(getNumThreads());
             // Allow an alternate bench depth argument
             if (inputVector.size() == 2)
-                timeParams.allotment = std::stoi(inputVector.at(1));
-
-            for (unsigned int i = 0; i < positions.size(); i++) {
-                clearAll(board);
-                board = fenToBoard(positions.at(i));
+                options.limit = std::stoi(inputVector.at(1));
 
-                isStop = false;
-                stopSignal = false;
-                getBestMove(&board, &timeParams, &movesToSearch);
-                isStop = true;
-                stopSignal = true;
-
-                totalNodes += getNodes();
+            parseBenchOptions(inputVector, rawInputVector, options);
+            runBench(options);
+            clearAll(board);
+        }
+        // smpbench [threads <max>|<n>,<n>...] [movetime|nodes <n>] and the
+        // other bench arguments. Given a maximum, thread counts double up to it.
+        else if (command.type == CMD_SMPBENCH) {
+            BenchOptions options;
+            options.searchMode = MOVETIME;
+            options.limit = DEFAULT_SMPBENCH_MOVETIME;
+            options.threads.push_back(std::max(1, (int) std::thread::hardware_concurrency()));
+            parseBenchOptions(inputVector, rawInputVector, options);
+
+            if (options.threads.size() == 1) {
+                int maxThreads = options.threads[0];
+                options.threads.clear();
+                for (int n = 1; n < maxThreads; n *= 2)
+                    options.threads.push_back(n);
+                options.threads.push_back(maxThreads);
             }
 
-            uint64_t time = getTimeElapsed(startTime);
-
+            runSMPBench(options);
+            clearAll(board);
+        }
+        // perftsuite [depth <n>] [format text|json|csv] [output <path>]
+        else if (command.type == CMD_PERFTSUITE) {
+            BenchOptions options;
+            options.limit = 0;
+            parseBenchOptions(inputVector, rawInputVector, options);
+            if (!runPerftSuite(options))
+                exitStatus = 1;
+        }
+        // microbench [file <path>] [repeat <n>] [warmup <n>] [format text|json|csv] [output <path>]
+        else if (command.type == CMD_MICROBENCH) {
+            BenchOptions options;
+            parseBenchOptions(inputVector, rawInputVector, options);
+            runMicroBench(options);
             clearAll(board);
-
-            cerr << "Nodes: " << totalNodes << endl;
-            cerr << "Time: " << time << endl;
-            cerr << "Nodes/second: " << 1000 * totalNodes / time << endl;
         }
-        else if (input == "eval") {
+        else if (command.type == CMD_POSITIONSTATS) {
+            cerr << "Full updates: " << positionCache.fullUpdates << endl;
+            cerr << "Incremental updates: " << positionCache.incrementalUpdates << endl;
+            cerr << "Moves skipped: " << positionCache.skippedMoves << endl;
+            cerr << "Time saved (us): " << positionCache.lastTimeSaved << " last, "
+                 << positionCache.totalTimeSaved << " total" << endl;
+        }
+        else if (command.type == CMD_EVAL) {
             Eval e;
             e.evaluate<true>(board);
         }
 
         // According to UCI protocol, inputs that do not make sense are ignored
     }
+
+    // The input thread has already stopped any search
+    if (searchThread.joinable())
+        searchThread.join();
+    flushOutput();
+    closeDebugLog();
+    closeSearchTrace();
+    return exitStatus;
+}
+
+// Reads the arguments shared by bench and smpbench
+void parseBenchOptions(std::vector<string> &inputVector, std::vector<string> &rawInputVector,
+        BenchOptions &options) {
+    for (unsigned int i = 1; i + 1 < inputVector.size(); i++) {
+        const string &arg = inputVector.at(i);
+        if (arg == "file")
+            options.positionFile = rawInputVector.at(i+1);
+        else if (arg == "output")
+            options.outputFile = rawInputVector.at(i+1);
+        else if (arg == "depth" || arg == "nodes" || arg == "movetime") {
+            options.searchMode = (arg == "nodes") ? NODES
+                               : (arg == "movetime") ? MOVETIME : DEPTH;
+            options.limit = (int) std::min(std::stoll(inputVector.at(i+1)), (long long) INT32_MAX);
+            if (options.searchMode == DEPTH)
+                options.limit = std::min(MAX_DEPTH, options.limit);
+        }
+        else if (arg == "threads") {
+            options.threads.clear();
+            std::vector<string> counts = split(inputVector.at(i+1), ',');
+            for (unsigned int j = 0; j < counts.size(); j++) {
+                if (!counts[j].empty())
+                    options.threads.push_back(std::min(MAX_THREADS, std::max(MIN_THREADS, std::stoi(counts[j]))));
+            }
+        }
+        else if (arg == "repeat")
+            options.repetitions = std::max(1, std::stoi(inputVector.at(i+1)));
+        else if (arg == "warmup")
+            options.warmup = std::max(0, std::stoi(inputVector.at(i+1)));
+        else if (arg == "format") {
+            string format = inputVector.at(i+1);
+            options.format = (format == "json") ? BENCH_JSON
+                           : (format == "csv") ? BENCH_CSV : BENCH_TEXT;
+        }
+        else
+            continue;
+        i++;
+    }
 }
 
-void setPosition(string &input, std::vector<string> &inputVector, Board &board) {
-    string pos;
+UCICommand parseCommand(const string &line) {
+    UCICommand command;
+    command.input = line;
+    // Some GUIs end lines with \r\n
+    if (!command.input.empty() && command.input.back() == '\r')
+        command.input.pop_back();
+    command.rawTokens = split(command.input, ' ');
+    stringToLowerCase(command.input);
+    command.tokens = split(command.input, ' ');
+
+    command.type = CMD_UNKNOWN;
+    if (!command.tokens.empty()) {
+        for (unsigned int i = 0; i < sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]); i++) {
+            if (command.tokens[0] == COMMAND_NAMES[i].first) {
+                command.type = COMMAND_NAMES[i].second;
+                break;
+            }
+        }
+    }
+    return command;
+}
 
-    if (input.find("startpos") != string::npos)
-        pos = STARTPOS;
+// The input thread. End of input is treated as quit.
+void readInput() {
+    string line;
+    while (true) {
+        if (!std::getline(std::cin, line))
+            line = "quit";
+        logInput(line);
+        UCICommand command = parseCommand(line);
+
+        if (command.type == CMD_DUMPSTATE) {
+            dumpSearchState(std::cerr);
+            continue;
+        }
 
-    if (input.find("fen") != string::npos) {
-        if (inputVector.size() < 5 || inputVector.at(4) == "moves") {
-            pos = inputVector.at(2) + ' ' + inputVector.at(3) + " - -";
+        std::lock_guard<std::mutex> lock(commandMutex);
+        // Commands queued ahead must run first
+        bool isLive = searching && commandQueue.empty();
+        if (command.type == CMD_QUIT) {
+            // Drop commands that would start another search
+            commandQueue.erase(std::remove_if(commandQueue.begin(), commandQueue.end(),
+                [](const UCICommand &c) { return c.type == CMD_GO || c.type == CMD_POSITION; }),
+                commandQueue.end());
+            quitting = true;
+            recordStopCommand();
+            stopSearch();
         }
-        else if (inputVector.size() < 7 || inputVector.at(6) == "moves") {
-            pos = inputVector.at(2) + ' ' + inputVector.at(3) + ' ' + inputVector.at(4) + ' '
-                + inputVector.at(5);
+        else if (isLive && command.type == CMD_ISREADY) {
+            writeLine("readyok");
+            continue;
         }
-        else {
-            pos = inputVector.at(2) + ' ' + inputVector.at(3) + ' ' + inputVector.at(4) + ' '
-                + inputVector.at(5) + ' ' + inputVector.at(6) + ' ' + inputVector.at(7);
+        else if (isLive && command.type == CMD_STOP) {
+            recordStopCommand();
+            stopSearch();
+            continue;
         }
+        else if (isLive && command.type == CMD_PONDERHIT) {
+            stopPonder();
+            continue;
+        }
+
+        commandQueue.push_back(std::move(command));
+        commandReady.notify_one();
+        if (commandQueue.back().type == CMD_QUIT)
+            return;
     }
+}
+
+// The search thread started by go
+void runSearch(Board *b, TimeManagement *timeParams, MoveList *movesToSearch) {
+    getBestMove(b, timeParams, movesToSearch);
+    std::lock_guard<std::mutex> lock(commandMutex);
+    searching = false;
+}
+
+void stopSearch() {
+    stopPonder();
+    isStop = true;
+    stopSignal = true;
+}
+
+#ifndef _WIN32
+void handleDumpSignal() {
+    sigset_t dumpSignal;
+    sigemptyset(&dumpSignal);
+    sigaddset(&dumpSignal, SIGUSR1);
+    while (true) {
+        int signal;
+        if (sigwait(&dumpSignal, &signal) == 0)
+            dumpSearchState(std::cerr);
+    }
+}
+#endif
+
+void setPosition(string &input, std::vector<string> &inputVector, Board &board,
+        TwoFoldStack *twoFoldPositions, PositionCache *cache) {
+    auto startTime = ChessClock::now();
+
+    // Split the command into the starting position and the move list
+    std::vector<string>::iterator movesIt = find(inputVector.begin(), inputVector.end(), "moves");
+    string base;
+    for (std::vector<string>::iterator it = inputVector.begin() + 1; it != movesIt; ++it)
+        base += *it + ' ';
+    std::vector<string> moves;
+    if (movesIt != inputVector.end()) {
+        for (std::vector<string>::iterator it = movesIt + 1; it != inputVector.end(); ++it) {
+            if (!it->empty())
+                moves.push_back(*it);
+        }
+    }
+
+    // If the command extends the last one, only the new moves are played
+    unsigned int firstMove = 0;
+    bool incremental = false;
+    if (cache != nullptr && cache->base == base
+     && cache->zobristKey == board.getZobristKey()
+     && cache->twoFoldSize == twoFoldPositions->size()
+     && cache->moves.size() <= moves.size()
+     && std::equal(cache->moves.begin(), cache->moves.end(), moves.begin())) {
+        firstMove = cache->moves.size();
+        incremental = true;
+    }
+    else {
+        string pos;
 
-    board = fenToBoard(pos);
-    TwoFoldStack *twoFoldPositions = getTwoFoldStackPointer();
-    twoFoldPositions->clear();
-
-    size_t moveListStart = input.find("moves");
-    if (moveListStart != string::npos) {
-        moveListStart += 6;
-        // Check for a non-empty movelist
-        if (moveListStart < input.length()) {
-            string moveList = input.substr(moveListStart);
-            std::istringstream is(moveList);
-            // moveStr contains the move in long algebraic notation
-            string moveStr;
-            while (is >> moveStr) {
-                bool reversible;
-                Move m = stringToMove(moveStr, board, reversible);
-
-                // Record positions on two fold stack.
-                twoFoldPositions->push(board.getZobristKey());
-                // The stack is cleared for captures, pawn moves, and castles, which are all
-                // irreversible
-                if (!reversible)
-                    twoFoldPositions->clear();
-
-                board.doMove(m, board.getPlayerToMove());
+        if (input.find("startpos") != string::npos)
+            pos = STARTPOS;
+
+        if (input.find("fen") != string::npos) {
+            if (inputVector.size() < 5 || inputVector.at(4) == "moves") {
+                pos = inputVector.at(2) + ' ' + inputVector.at(3) + " - -";
+            }
+            else if (inputVector.size() < 7 || inputVector.at(6) == "moves") {
+                pos = inputVector.at(2) + ' ' + inputVector.at(3) + ' ' + inputVector.at(4) + ' '
+                    + inputVector.at(5);
+            }
+            else {
+                pos = inputVector.at(2) + ' ' + inputVector.at(3) + ' ' + inputVector.at(4) + ' '
+                    + inputVector.at(5) + ' ' + inputVector.at(6) + ' ' + inputVector.at(7);
             }
         }
+
+        board = fenToBoard(pos);
+        twoFoldPositions->clear();
+    }
+
+    // Make sure the stack has room for the game and a full search without
+    // reallocating
+    twoFoldPositions->reserve(inputVector.size() + 2 * MAX_DEPTH);
+    for (unsigned int i = firstMove; i < moves.size(); i++) {
+        bool reversible;
+        Move m = stringToMove(moves[i], board, reversible);
+
+        // Record positions on two fold stack.
+        twoFoldPositions->push(board.getZobristKey());
+        // The stack is cleared for captures, pawn moves, and castles, which are all
+        // irreversible
+        if (!reversible)
+            twoFoldPositions->clear();
+
+        board.doMove(m, board.getPlayerToMove());
     }
-}
 
-// Splits a string s with delimiter d.
-std::vector<string> split(const string &s, char d) {
-    std::vector<string> v;
-    std::stringstream ss(s);
-    string item;
-    while (getline(ss, item, d)) {
-        v.push_back(item);
+    if (cache == nullptr)
+        return;
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+        ChessClock::now() - startTime).count();
+    if (!incremental) {
+        cache->fullUpdates++;
+        if (!moves.empty()) {
+            cache->fullMoves += moves.size();
+            cache->fullTime += time;
+        }
+        cache->lastTimeSaved = 0;
     }
-    return v;
+    else {
+        // Estimate the replay time saved from the cost per move of full updates
+        cache->incrementalUpdates++;
+        cache->skippedMoves += firstMove;
+        cache->lastTimeSaved = firstMove * cache->fullTime / std::max(cache->fullMoves, (uint64_t) 1);
+        cache->totalTimeSaved += cache->lastTimeSaved;
+    }
+    cache->base = base;
+    std::swap(cache->moves, moves);
+    cache->zobristKey = board.getZobristKey();
+    cache->twoFoldSize = twoFoldPositions->size();
 }
 
 Move stringToMove(const string &moveStr, Board &b, bool &reversible) {
@@ -458,91 +791,60 @@ Move stringToMove(const string &moveStr, Board &b, bool &reversible) {
     return m;
 }
 
-Board fenToBoard(string s) {
-    std::vector<string> components = split(s, ' ');
-    std::vector<string> rows = split(components.at(0), '/');
-    int mailbox[64];
-    int sqCounter = -1;
-    string pieceString = "PNBRQKpnbrqk";
-
-    // iterate through rows backwards (because mailbox goes a1 -> h8), converting into mailbox format
-    for (int elem = 7; elem >= 0; elem--) {
-        string rowAtElem = rows.at(elem);
-
-        for (unsigned col = 0; col < rowAtElem.length(); col++) {
-            char sq = rowAtElem.at(col);
-            do mailbox[++sqCounter] = pieceString.find(sq--);
-            while ('0' < sq && sq < '8');
-        }
+// Sets the search mode and time allotments from the limits in a go command.
+// If no limits are given, the previous ones are kept.
+void setTimeParams(string &input, std::vector<string> &inputVector, Board &board,
+        TimeManagement *timeParams, int bufferTime) {
+    std::vector<string>::iterator it;
+
+    if (input.find("movetime") != string::npos && inputVector.size() > 2) {
+        timeParams->searchMode = MOVETIME;
+        it = find(inputVector.begin(), inputVector.end(), "movetime");
+        it++;
+        timeParams->allotment = std::stoi(*it);
     }
-
-    int playerToMove = (components.at(1) == "w") ? WHITE : BLACK;
-    bool whiteCanKCastle = (components.at(2).find("K") != string::npos);
-    bool whiteCanQCastle = (components.at(2).find("Q") != string::npos);
-    bool blackCanKCastle = (components.at(2).find("k") != string::npos);
-    bool blackCanQCastle = (components.at(2).find("q") != string::npos);
-    int epCaptureFile = (components.at(3) == "-") ? NO_EP_POSSIBLE
-        : components.at(3).at(0) - 'a';
-    int fiftyMoveCounter = (components.size() == 6) ? std::stoi(components.at(4)) : 0;
-    int moveNumber = (components.size() == 6) ? std::stoi(components.at(5)) : 1;
-    return Board(mailbox, whiteCanKCastle, blackCanKCastle, whiteCanQCastle,
-            blackCanQCastle, epCaptureFile, fiftyMoveCounter, moveNumber,
-            playerToMove);
-}
-
-string boardToFEN(Board &board) {
-    int *mailbox = board.getMailbox();
-    string pieceString = "PNBRQKpnbrqk";
-    string fenString;
-    int emptyCt = 0;
-
-    for (int r = 7; r >= 0; r--) {
-        for (int f = 0; f < 8; f++) {
-            int sq = 8*r + f;
-            if (mailbox[sq] == -1)
-                emptyCt++;
-            else {
-                if (emptyCt) {
-                    fenString += std::to_string(emptyCt);
-                    emptyCt = 0;
-                }
-                fenString += pieceString[mailbox[sq]];
-            }
+    else if (input.find("depth") != string::npos && inputVector.size() > 2) {
+        timeParams->searchMode = DEPTH;
+        it = find(inputVector.begin(), inputVector.end(), "depth");
+        it++;
+        timeParams->allotment = std::min(MAX_DEPTH, std::stoi(*it));
+    }
+    else if (input.find("nodes") != string::npos && inputVector.size() > 2) {
+        timeParams->searchMode = NODES;
+        it = find(inputVector.begin(), inputVector.end(), "nodes");
+        it++;
+        timeParams->allotment = (int) std::min(std::stoll(*it), (long long) INT32_MAX);
+    }
+    else if (input.find("infinite") != string::npos) {
+        timeParams->searchMode = DEPTH;
+        timeParams->allotment = MAX_DEPTH;
+    }
+    else if (input.find("wtime") != string::npos
+          || input.find("btime") != string::npos) {
+        int color = board.getPlayerToMove();
+        it = find(inputVector.begin(), inputVector.end(), (color == WHITE) ? "wtime" : "btime");
+        it++;
+        int timeRemaining = std::stoi(*it);
+
+        // Parse recurring time controls, if any
+        int movesToGo = 0;
+        it = find(inputVector.begin(), inputVector.end(), "movestogo");
+        if (it != inputVector.end()) {
+            it++;
+            movesToGo = std::stoi(*it);
         }
 
-        if (emptyCt) {
-            fenString += std::to_string(emptyCt);
-            emptyCt = 0;
+        // Parse the increment if available
+        int increment = 0;
+        it = find(inputVector.begin(), inputVector.end(), (color == WHITE) ? "winc" : "binc");
+        if (it != inputVector.end()) {
+            it++;
+            increment = std::stoi(*it);
         }
-        if (r != 0)
-            fenString += '/';
-    }
 
-    fenString += ' ';
-    fenString += (board.getPlayerToMove() == WHITE) ? 'w' : 'b';
-    fenString += ' ';
-    bool hasCastles = false;
-    if (board.getWhiteCanKCastle()) { hasCastles = true; fenString += 'K'; }
-    if (board.getWhiteCanQCastle()) { hasCastles = true; fenString += 'Q'; }
-    if (board.getBlackCanKCastle()) { hasCastles = true; fenString += 'k'; }
-    if (board.getBlackCanQCastle()) { hasCastles = true; fenString += 'q'; }
-    if (!hasCastles) fenString += '-';
-    fenString += ' ';
-
-    uint16_t epCaptureFile = board.getEPCaptureFile();
-    if (epCaptureFile == NO_EP_POSSIBLE)
-        fenString += '-';
-    else {
-        fenString += 'a' + epCaptureFile;
-        fenString += (board.getPlayerToMove() == WHITE) ? '6' : '3';
+        allocateTime(timeParams, timeRemaining, increment, movesToGo,
+            board.getMoveNumber(), bufferTime);
     }
-
-    fenString += ' ';
-    fenString += std::to_string(board.getFiftyMoveCounter());
-    fenString += ' ';
-    fenString += std::to_string(board.getMoveNumber());
-
-    return fenString;
 }
 
 string boardToString(Board &board) {
@@ -598,39 +900,3 @@ void clearAll(Board &board) {
     clearTables();
     board = fenToBoard(STARTPOS);
 }
-
-/*
- * Performs a PERFT (performance test). Useful for testing/debugging
- * PERFT n counts the number of possible positions after n moves by either side,
- * ex. PERFT 4 = # of positions after 2 moves from each side
- *
- * 7/8/15: PERFT 5, 1.46 s (i5-2450m)
- * 7/11/15: PERFT 5, 1.22 s (i5-2450m)
- * 7/13/15: PERFT 5, 1.08 s (i5-2450m)
- * 7/14/15: PERFT 5, 0.86 s (i5-2450m)
- * 7/17/15: PERFT 5, 0.32 s (i5-2450m)
- * 8/7/15: PERFT 5, 0.25 s, PERFT 6, 6.17 s (i5-5200u)
- * 8/8/15: PERFT 6, 5.90 s (i5-5200u)
- * 8/11/15: PERFT 6, 5.20 s (i5-5200u)
- */
-uint64_t perft(Board &b, int color, int depth, uint64_t &captures) {
-    if (depth == 0)
-        return 1;
-
-    uint64_t nodes = 0;
-
-    MoveList pl;
-    b.getAllPseudoLegalMoves(pl, color);
-    for (unsigned int i = 0; i < pl.size(); i++) {
-        Board copy = b.staticCopy();
-        if (!copy.doPseudoLegalMove(pl.get(i), color))
-            continue;
-
-        if (isCapture(pl.get(i)))
-            captures++;
-
-        nodes += perft(copy, color^1, depth-1, captures);
-    }
-
-    return nodes;
-}
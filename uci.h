@@ -21,6 +21,12 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+
+const std::string ENGINE_NAME = "Laser";
+const std::string ENGINE_VERSION = "1.6 beta";
+const std::string ENGINE_AUTHOR = "Jeffrey An and Michael An";
+const std::string STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
 const uint64_t DEFAULT_HASH_SIZE = 16;
 const uint64_t MIN_HASH_SIZE = 1;
@@ -38,6 +44,40 @@ const int DEFAULT_EVAL_SCALE = 100;
 const int MIN_EVAL_SCALE = 0;
 const int MAX_EVAL_SCALE = 500;
 
+/*
+ * @brief The last position command applied to a board. A position command
+ * that only adds moves to it is applied incrementally, as long as the board
+ * and two-fold stack have not changed since. The remaining fields record how
+ * much replaying moves this saved.
+ */
+struct PositionCache {
+    std::string base;
+    std::vector<std::string> moves;
+    uint64_t zobristKey;
+    unsigned int twoFoldSize;
+
+    uint64_t fullUpdates;
+    uint64_t incrementalUpdates;
+    // Moves replayed in full updates, and the time spent on them, in us
+    uint64_t fullMoves;
+    uint64_t fullTime;
+    // Moves that did not need to be replayed
+    uint64_t skippedMoves;
+    // Estimated time saved by the last command and by all commands, in us
+    uint64_t lastTimeSaved;
+    uint64_t totalTimeSaved;
+
+    PositionCache() {
+        zobristKey = 0;
+        twoFoldSize = 0;
+        fullUpdates = incrementalUpdates = 0;
+        fullMoves = fullTime = skippedMoves = 0;
+        lastTimeSaved = totalTimeSaved = 0;
+    }
+};
+
+// Defined in board.cpp
+std::vector<std::string> split(const std::string &s, char d);
 Board fenToBoard(std::string s);
 std::string boardToFEN(Board &board);
 